@@ -0,0 +1,235 @@
+//
+// Headless batch runner: runs many independent chip8 instances across
+// all cores and prints one result line per instance.
+//
+// usage: batch [-j threads] [--jit] [--seed n] [--variant name] [--skip-loops] <joblist>
+//
+// Each line of the job list is "<rom path> <cycles> [copies]". Blank
+// lines and lines starting with '#' are ignored. Instance i is seeded
+// with n + i (n defaults to 0), so every run of a job list gives the
+// same results.
+//
+// With --skip-loops, instances run a frame at a time and remember each
+// frame's state hash. An instance whose state comes round again is in a
+// loop (nothing else can change, since no input arrives), so whole laps
+// of it are skipped. Results are the same as running every cycle.
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "chip8.h"
+#include "chip8table.h"
+using namespace std;
+
+struct job {
+    string rom;
+    unsigned long cycles;
+    const romImage* image;      // null when the ROM couldn't be loaded
+};
+
+struct result {
+    bool loaded;
+    unsigned long cycles;
+    unsigned long long frameHash;
+    unsigned char V[16];
+    unsigned short indexReg;
+    unsigned short programCount;
+};
+
+/* One queue per worker. The owner pops from the front; idle workers
+ * steal from the back, so long jobs queued behind a busy worker get
+ * picked up by whoever runs out of work first. */
+class workQueue {
+public:
+    void push(size_t item)
+    {
+        lock_guard<mutex> guard(lock);
+        items.push_back(item);
+    }
+
+    bool pop(size_t& item)
+    {
+        lock_guard<mutex> guard(lock);
+        if(items.empty()) return false;
+        item = items.front();
+        items.pop_front();
+        return true;
+    }
+
+    bool steal(size_t& item)
+    {
+        lock_guard<mutex> guard(lock);
+        if(items.empty()) return false;
+        item = items.back();
+        items.pop_back();
+        return true;
+    }
+
+private:
+    mutex lock;
+    deque<size_t> items;
+};
+
+static bool readJobs(const char* path, vector<job>& jobs)
+{
+    ifstream input(path);
+    if(!input) {
+        cerr << "Could not open job list " << path << endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+    while(getline(input, line)) {
+        ++lineNumber;
+        if(line.empty() || line[0] == '#') continue;
+
+        istringstream fields(line);
+        job j;
+        unsigned long copies = 1;
+        if(!(fields >> j.rom >> j.cycles)) {
+            cerr << path << ":" << lineNumber << ": expected \"<rom> <cycles> [copies]\"" << endl;
+            return false;
+        }
+        fields >> copies;
+        for(unsigned long i = 0; i < copies; ++i) jobs.push_back(j);
+    }
+    return true;
+}
+
+// run cycles a frame at a time; once the state after a frame has been
+// seen before, the frames since then repeat forever, so only the laps
+// that don't fit in what is left are run
+static void runSkippingLoops(chip8& c8, unsigned long cycles, chip8table& seen)
+{
+    seen.clear();
+    unsigned long frame = c8.getCyclesPerFrame();
+    unsigned long frames = cycles / frame;
+    for(unsigned long f = 0; f < frames; ++f) {
+        uint64_t first = f;
+        if(seen.visit(c8.stateHash(), first)) {
+            unsigned long period = f - first;
+            c8.runCycles(((frames - f) % period) * frame);
+            break;
+        }
+        c8.runCycles(frame);
+    }
+    c8.runCycles(cycles % frame);
+}
+
+static void runJob(const job& j, bool useJit, chip8variant variant, uint64_t seed, chip8table* seen, result& r)
+{
+    // trace and profile builds make instances large, keep them off the worker stacks
+    unique_ptr<chip8> c8(new chip8());
+    c8->seed(seed);
+    c8->setVariant(variant);
+
+    r.loaded = j.image && c8->loadImage(*j.image);
+    r.cycles = 0;
+    if(r.loaded) {
+        c8->enableJit(useJit);
+        if(seen) runSkippingLoops(*c8, j.cycles, *seen);
+        else c8->runCycles(j.cycles);
+        r.cycles = j.cycles;
+    }
+
+    r.frameHash = c8->frameHash();
+    memcpy(r.V, c8->getRegisters(), sizeof(r.V));
+    r.indexReg = c8->getIndexReg();
+    r.programCount = c8->getProgramCount();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int threads = thread::hardware_concurrency();
+    bool useJit = false;
+    chip8variant variant = variantChip8;
+    uint64_t seed = 0;
+    bool skipLoops = false;
+    const char* jobList = nullptr;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--jit") == 0) useJit = true;
+        else if(strcmp(argv[i], "--variant") == 0 && i + 1 < argc) {
+            if(!variantFromName(argv[++i], variant)) {
+                cerr << "Unknown variant " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--skip-loops") == 0) skipLoops = true;
+        else jobList = argv[i];
+    }
+    if(!jobList) {
+        cerr << "usage: " << argv[0] << " [-j threads] [--jit] [--seed n] [--variant name] [--skip-loops] <joblist>" << endl;
+        return 1;
+    }
+    if(threads == 0) threads = 1;
+
+    vector<job> jobs;
+    if(!readJobs(jobList, jobs)) return 1;
+
+    // map every ROM once up front; instances then load with a single copy
+    chip8roms roms;
+    map<string, const romImage*> opened;
+    for(job& j : jobs) {
+        auto known = opened.find(j.rom);
+        if(known == opened.end()) {
+            string error;
+            const romImage* image = roms.open(j.rom, error);
+            if(!image) cerr << error << endl;
+            known = opened.insert(make_pair(j.rom, image)).first;
+        }
+        j.image = known->second;
+    }
+
+    vector<result> results(jobs.size());
+    vector<workQueue> queues(threads);
+    for(size_t i = 0; i < jobs.size(); ++i) {
+        queues[i % threads].push(i);
+    }
+
+    // no job spawns more work, so a worker is done once every queue is empty
+    vector<thread> workers;
+    for(unsigned int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            // a loop longer than the table holds is simply not skipped
+            unique_ptr<chip8table> seen(skipLoops ? new chip8table(1 << 14) : nullptr);
+            size_t item;
+            for(;;) {
+                bool found = queues[t].pop(item);
+                for(unsigned int v = 1; !found && v < threads; ++v) {
+                    found = queues[(t + v) % threads].steal(item);
+                }
+                if(!found) return;
+                runJob(jobs[item], useJit, variant, seed + item, seen.get(), results[item]);
+            }
+        });
+    }
+    for(auto& w : workers) w.join();
+
+    // instance rom status cycles hash I PC V0..VF
+    int failed = 0;
+    for(size_t i = 0; i < jobs.size(); ++i) {
+        const result& r = results[i];
+        if(!r.loaded) ++failed;
+        printf("%zu %s %s %lu %016llx %03X %03X", i, jobs[i].rom.c_str(), r.loaded ? "ok" : "failed",
+               r.cycles, r.frameHash, r.indexReg, r.programCount);
+        for(int v = 0; v < 16; ++v) printf(" %02X", r.V[v]);
+        printf("\n");
+    }
+
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,306 @@
+//
+// Benchmarks for the chip8 engines.
+//
+// usage: bench [--jit] [--roms dir] [--repeat n] [--variant name]
+//        bench [--variant name] <rom> [lanes] [cycles]
+//
+// The first form runs the benchmark suite: the bundled games headless
+// with scripted input, then one synthetic program per opcode class,
+// then forking a child off a running program and running it for a few
+// cycles, once for every interpreter variant (or just the one named). Each
+// benchmark runs <repeat> times and the fastest run is reported as one
+// CSV line, so the output of two commits can be diffed.
+//
+// The second form runs the same ROM as <lanes> scalar chip8 instances
+// and as one chip8wide, each lane with its own seed and key pattern,
+// checks that both end in the same state and reports instructions per
+// second for each. Scalar instances skip idle loops, chip8wide doesn't.
+//
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "chip8.h"
+#include "chip8wide.h"
+using namespace std;
+
+// heap allocations made by the process, counted by the operators below
+static atomic<unsigned long> allocations(0);
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if(void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+// cycles between keypad changes
+static const unsigned long inputPeriod = 500;
+
+// the key pattern held by a lane during one input period
+static bool keyDown(size_t lane, unsigned long period, int key)
+{
+    unsigned long long h = (lane + 1) * 0x9E3779B97F4A7C15ULL ^ (period + 1) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    return ((h >> key) & 0x3) == 0;
+}
+
+static double seconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* Synthetic programs, one per opcode class. Each is an endless loop
+ * loaded at 0x200. */
+struct microBenchmark {
+    const char* name;
+    vector<unsigned char> program;
+};
+
+static const microBenchmark microBenchmarks[] = {
+    // V0 = 1, V1 = 2, then every 8XYn op on V0/V1 in a loop
+    { "alu_8xyn", { 0x60, 0x01, 0x61, 0x02,
+                    0x80, 0x10, 0x80, 0x11, 0x80, 0x12, 0x80, 0x13, 0x80, 0x14,
+                    0x80, 0x15, 0x80, 0x16, 0x80, 0x17, 0x80, 0x1E, 0x71, 0x01,
+                    0x12, 0x04 } },
+    // font sprite for 0, drawn at a moving x/y
+    { "draw_dxyn", { 0xA0, 0x00, 0x60, 0x00, 0x61, 0x00,
+                     0xD0, 0x15, 0x70, 0x03, 0x71, 0x01,
+                     0x12, 0x06 } },
+    // store and load V0-V7 at 0x300
+    { "memory_fx55_fx65", { 0xA3, 0x00, 0x70, 0x01,
+                            0xF7, 0x55, 0xF7, 0x65,
+                            0x12, 0x00 } },
+    // a jump chain
+    { "jump_1nnn", { 0x12, 0x02, 0x12, 0x04, 0x12, 0x06, 0x12, 0x00 } },
+    // call a subroutine that returns at once
+    { "call_2nnn_00ee", { 0x22, 0x04, 0x12, 0x00, 0x00, 0xEE } },
+    // conditional skips, both taken and not taken
+    { "skip_3x_4x_5x_9x", { 0x30, 0x01, 0x40, 0x01, 0x60, 0x00,
+                            0x50, 0x10, 0x60, 0x00, 0x90, 0x10, 0x60, 0x00,
+                            0x12, 0x00 } },
+};
+
+/* Programs to fork children from: fork_run's children only touch
+ * registers, fork_store's store to memory and so take a private copy. */
+static const microBenchmark forkBenchmarks[] = {
+    { "fork_run", { 0x60, 0x01, 0x70, 0x01, 0x70, 0x01, 0x12, 0x02 } },
+    { "fork_store", { 0xA3, 0x00, 0xF7, 0x55, 0x70, 0x01, 0x12, 0x02 } },
+};
+
+// cycles each forked child runs
+static const unsigned long forkCycles = 8;
+
+struct measurement {
+    unsigned long instructions;
+    double seconds;
+    unsigned long allocations;
+};
+
+/* Runs an already loaded instance; with scripted input the keypad
+ * follows lane 0's key pattern. */
+static measurement measure(chip8& c8, unsigned long cycles, bool scriptedInput)
+{
+    unsigned long before = allocations;
+    auto start = chrono::steady_clock::now();
+
+    for(unsigned long done = 0; done < cycles; done += inputPeriod) {
+        if(scriptedInput) {
+            for(int k = 0; k < 16; ++k) c8.keypad[k] = keyDown(0, done / inputPeriod, k);
+        }
+        c8.runCycles(min(inputPeriod, cycles - done));
+    }
+
+    return { cycles, seconds(start), allocations - before };
+}
+
+/* Forks child off a running parent and runs it, forks times over;
+ * instructions counts the children's cycles. */
+static measurement measureForks(chip8& parent, chip8& child, unsigned long forks)
+{
+    unsigned long before = allocations;
+    auto start = chrono::steady_clock::now();
+
+    for(unsigned long i = 0; i < forks; ++i) {
+        parent.fork(child);
+        child.runCycles(forkCycles);
+    }
+
+    return { forks * forkCycles, seconds(start), allocations - before };
+}
+
+static void report(const string& name, chip8variant variant, bool useJit, const measurement& m)
+{
+    // only the chip8 variant runs compiled code
+    bool compiled = useJit && variant == variantChip8;
+    printf("%s,%s,%s,%lu,%.6f,%.0f,%.3f,%lu\n", name.c_str(), variantName(variant),
+           compiled ? "jit" : "interpreter", m.instructions, m.seconds, m.instructions / m.seconds,
+           m.seconds * 1e9 / m.instructions, m.allocations);
+}
+
+static int runVariant(const string& roms, chip8variant variant, bool useJit, int repeat)
+{
+    static const unsigned long gameCycles = 2000000;
+    static const unsigned long microCycles = 4000000;
+    static const unsigned long forks = 500000;
+    static const char* games[] = { "PONG", "TETRIS" };
+
+    unique_ptr<chip8> c8(new chip8());
+    c8->enableJit(useJit);
+    c8->setVariant(variant);
+
+    for(const char* game : games) {
+        measurement best = { 0, 0, 0 };
+        for(int r = 0; r < repeat; ++r) {
+            if(!c8->loadGame(roms + "/" + game)) {
+                cerr << "Could not load " << roms << "/" << game << endl;
+                return 1;
+            }
+            measurement m = measure(*c8, gameCycles, true);
+            if(r == 0 || m.seconds < best.seconds) best = m;
+        }
+        report(game, variant, useJit, best);
+    }
+
+    for(const microBenchmark& b : microBenchmarks) {
+        measurement best = { 0, 0, 0 };
+        for(int r = 0; r < repeat; ++r) {
+            c8->loadProgram(b.program.data(), b.program.size());
+            measurement m = measure(*c8, microCycles, false);
+            if(r == 0 || m.seconds < best.seconds) best = m;
+        }
+        report(b.name, variant, useJit, best);
+    }
+
+    unique_ptr<chip8> child(new chip8());
+    for(const microBenchmark& b : forkBenchmarks) {
+        measurement best = { 0, 0, 0 };
+        for(int r = 0; r < repeat; ++r) {
+            c8->loadProgram(b.program.data(), b.program.size());
+            c8->runCycles(forkCycles);
+            measurement m = measureForks(*c8, *child, forks);
+            if(r == 0 || m.seconds < best.seconds) best = m;
+        }
+        report(b.name, variant, false, best);
+    }
+
+    return 0;
+}
+
+// every variant, or only the given one
+static int runSuite(const string& roms, const char* only, bool useJit, int repeat)
+{
+    chip8variant selected = variantChip8;
+    if(only && !variantFromName(only, selected)) {
+        cerr << "Unknown variant " << only << endl;
+        return 1;
+    }
+
+    printf("benchmark,variant,engine,instructions,seconds,instructions_per_sec,ns_per_instruction,allocations\n");
+    for(int v = 0; v < variantCount; ++v) {
+        chip8variant variant = static_cast<chip8variant>(v);
+        if(only && variant != selected) continue;
+        if(runVariant(roms, variant, useJit, repeat) != 0) return 1;
+    }
+    return 0;
+}
+
+static int compareWide(const char* rom, size_t lanes, unsigned long cycles, const char* variantName)
+{
+    chip8variant variant = variantChip8;
+    if(variantName && !variantFromName(variantName, variant)) {
+        cerr << "Unknown variant " << variantName << endl;
+        return 1;
+    }
+
+    // scalar: one chip8 per lane, run one after another
+    vector<unique_ptr<chip8>> scalar;
+    for(size_t i = 0; i < lanes; ++i) {
+        scalar.emplace_back(new chip8());
+        scalar.back()->seed(i);
+        scalar.back()->setVariant(variant);
+        if(!scalar.back()->loadGame(rom)) return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    for(size_t i = 0; i < lanes; ++i) {
+        for(unsigned long done = 0; done < cycles; done += inputPeriod) {
+            for(int k = 0; k < 16; ++k) scalar[i]->keypad[k] = keyDown(i, done / inputPeriod, k);
+            scalar[i]->runCycles(min(inputPeriod, cycles - done));
+        }
+    }
+    double scalarTime = seconds(start);
+
+    // wide: all lanes in lockstep
+    chip8wide wide(lanes);
+    wide.setVariant(variant);
+    for(size_t i = 0; i < lanes; ++i) wide.seed(i, i);
+    if(!wide.loadGame(rom)) return 1;
+
+    start = chrono::steady_clock::now();
+    for(unsigned long done = 0; done < cycles; done += inputPeriod) {
+        for(size_t i = 0; i < lanes; ++i) {
+            for(int k = 0; k < 16; ++k) wide.setKey(i, k, keyDown(i, done / inputPeriod, k));
+        }
+        wide.runCycles(min(inputPeriod, cycles - done));
+    }
+    double wideTime = seconds(start);
+
+    size_t mismatches = 0;
+    for(size_t i = 0; i < lanes; ++i) {
+        const chip8& c = *scalar[i];
+        bool same = c.getIndexReg() == wide.getIndexReg(i) &&
+                    c.getProgramCount() == wide.getProgramCount(i) &&
+                    memcmp(c.getDisplay(), wide.getDisplay(i), 32 * sizeof(uint64_t)) == 0;
+        for(int r = 0; r < 16; ++r) same = same && c.getRegisters()[r] == wide.getV(i, r);
+        if(!same) ++mismatches;
+    }
+
+    double total = double(lanes) * cycles;
+    printf("engine,lanes,cycles,seconds,instructions_per_sec\n");
+    printf("scalar,%zu,%lu,%.4f,%.0f\n", lanes, cycles, scalarTime, total / scalarTime);
+    printf("wide,%zu,%lu,%.4f,%.0f\n", lanes, cycles, wideTime, total / wideTime);
+    printf("# speedup %.2fx, %zu of %zu lanes differ from scalar\n", scalarTime / wideTime, mismatches, lanes);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool useJit = false;
+    string roms = "c8games";
+    int repeat = 5;
+    const char* variant = nullptr;
+
+    int i = 1;
+    for(; i < argc && argv[i][0] == '-'; ++i) {
+        if(strcmp(argv[i], "--jit") == 0) useJit = true;
+        else if(strcmp(argv[i], "--roms") == 0 && i + 1 < argc) roms = argv[++i];
+        else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = max(1, atoi(argv[++i]));
+        else if(strcmp(argv[i], "--variant") == 0 && i + 1 < argc) variant = argv[++i];
+        else {
+            cerr << "usage: " << argv[0] << " [--jit] [--roms dir] [--repeat n] [--variant name]" << endl;
+            cerr << "       " << argv[0] << " [--variant name] <rom> [lanes] [cycles]" << endl;
+            return 1;
+        }
+    }
+
+    if(i == argc) return runSuite(roms, variant, useJit, repeat);
+
+    const char* rom = argv[i];
+    size_t lanes = (i + 1 < argc) ? strtoul(argv[i + 1], nullptr, 10) : 256;
+    unsigned long cycles = (i + 2 < argc) ? strtoul(argv[i + 2], nullptr, 10) : 100000;
+    return compareWide(rom, lanes, cycles, variant);
+}
@@ -0,0 +1,333 @@
+//
+// Static disassembler and ahead-of-time translator for CHIP-8 ROMs.
+//
+// usage: c8aot --disasm <rom>
+//        c8aot <rom> [symbol] > rom.cpp
+//
+// Both forms follow control flow from 0x200 to find the reachable
+// code and split it into basic blocks. --disasm prints the listing;
+// otherwise one C++ function per block is written to stdout, ending
+// in a chip8aot::program named <symbol> (default: the file name plus
+// "_aot"). Compile that file with the core and enable it with
+//
+//     extern const chip8aot::program PONG_aot;
+//     c8.enableAot(&PONG_aot);
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include "chip8.h"
+using namespace std;
+
+// blocks are split after this many instructions
+static const unsigned int maxBlockLength = 64;
+
+struct rom {
+    unsigned char memory[4096];
+    uint64_t hash;
+    unsigned short end;         // one past the last ROM byte
+
+    unsigned short opcode(unsigned short addr) const
+    {
+        return memory[addr & 0xFFF] << 8 | memory[(addr + 1) & 0xFFF];
+    }
+};
+
+struct basicBlock {
+    unsigned short addr;
+    unsigned short end;
+    vector<unsigned short> code;    // instruction addresses
+};
+
+static bool readRom(const char* path, rom& r)
+{
+    chip8roms roms;
+    string error;
+    const romImage* image = roms.open(path, error);
+    if(!image) {
+        cerr << error << endl;
+        return false;
+    }
+
+    memset(r.memory, 0, sizeof(r.memory));
+    memcpy(r.memory + 0x200, image->bytes, image->size);
+    r.hash = image->hash;
+    r.end = static_cast<unsigned short>(0x200 + image->size);
+    return true;
+}
+
+// Cowgod-style mnemonics
+static string disassemble(unsigned short op)
+{
+    instruction in = chip8aot::decode(op);
+    char text[32];
+
+    switch(in.handler) {
+    case h00E0: return "CLS";
+    case h00EE: return "RET";
+    case h1NNN: snprintf(text, sizeof(text), "JP 0x%03X", in.nnn); break;
+    case h2NNN: snprintf(text, sizeof(text), "CALL 0x%03X", in.nnn); break;
+    case h3XNN: snprintf(text, sizeof(text), "SE V%X, 0x%02X", in.x, in.nn); break;
+    case h4XNN: snprintf(text, sizeof(text), "SNE V%X, 0x%02X", in.x, in.nn); break;
+    case h5XY0: snprintf(text, sizeof(text), "SE V%X, V%X", in.x, in.y); break;
+    case h6XNN: snprintf(text, sizeof(text), "LD V%X, 0x%02X", in.x, in.nn); break;
+    case h7XNN: snprintf(text, sizeof(text), "ADD V%X, 0x%02X", in.x, in.nn); break;
+    case h8XY0: snprintf(text, sizeof(text), "LD V%X, V%X", in.x, in.y); break;
+    case h8XY1: snprintf(text, sizeof(text), "OR V%X, V%X", in.x, in.y); break;
+    case h8XY2: snprintf(text, sizeof(text), "AND V%X, V%X", in.x, in.y); break;
+    case h8XY3: snprintf(text, sizeof(text), "XOR V%X, V%X", in.x, in.y); break;
+    case h8XY4: snprintf(text, sizeof(text), "ADD V%X, V%X", in.x, in.y); break;
+    case h8XY5: snprintf(text, sizeof(text), "SUB V%X, V%X", in.x, in.y); break;
+    case h8XY6: snprintf(text, sizeof(text), "SHR V%X", in.x); break;
+    case h8XY7: snprintf(text, sizeof(text), "SUBN V%X, V%X", in.x, in.y); break;
+    case h8XYE: snprintf(text, sizeof(text), "SHL V%X", in.x); break;
+    case h9XY0: snprintf(text, sizeof(text), "SNE V%X, V%X", in.x, in.y); break;
+    case hANNN: snprintf(text, sizeof(text), "LD I, 0x%03X", in.nnn); break;
+    case hBNNN: snprintf(text, sizeof(text), "JP V0, 0x%03X", in.nnn); break;
+    case hCXNN: snprintf(text, sizeof(text), "RND V%X, 0x%02X", in.x, in.nn); break;
+    case hDXYN: snprintf(text, sizeof(text), "DRW V%X, V%X, %d", in.x, in.y, in.nn & 0xF); break;
+    case hEX9E: snprintf(text, sizeof(text), "SKP V%X", in.x); break;
+    case hEXA1: snprintf(text, sizeof(text), "SKNP V%X", in.x); break;
+    case hFX07: snprintf(text, sizeof(text), "LD V%X, DT", in.x); break;
+    case hFX0A: snprintf(text, sizeof(text), "LD V%X, K", in.x); break;
+    case hFX15: snprintf(text, sizeof(text), "LD DT, V%X", in.x); break;
+    case hFX18: snprintf(text, sizeof(text), "LD ST, V%X", in.x); break;
+    case hFX1E: snprintf(text, sizeof(text), "ADD I, V%X", in.x); break;
+    case hFX29: snprintf(text, sizeof(text), "LD F, V%X", in.x); break;
+    case hFX33: snprintf(text, sizeof(text), "LD B, V%X", in.x); break;
+    case hFX55: snprintf(text, sizeof(text), "LD [I], V%X", in.x); break;
+    case hFX65: snprintf(text, sizeof(text), "LD V%X, [I]", in.x); break;
+    default:    snprintf(text, sizeof(text), "DW 0x%04X", op); break;
+    }
+    return text;
+}
+
+// instructions left to the interpreter: computed jumps, key waits, garbage
+static bool translatable(unsigned char handler)
+{
+    return handler != hBNNN && handler != hFX0A && handler != hUnknown && handler != hDecode;
+}
+
+// instructions that end a block: everything that sets programCount
+static bool terminator(unsigned char handler)
+{
+    switch(handler) {
+    case h00EE: case h1NNN: case h2NNN: case h3XNN: case h4XNN:
+    case h5XY0: case h9XY0: case hEX9E: case hEXA1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Follows every statically known edge from 0x200. reached marks each
+ * instruction found, leader marks each address control can arrive at
+ * other than by falling through. */
+static void traceFlow(const rom& r, vector<bool>& reached, vector<bool>& leader)
+{
+    vector<unsigned short> work;
+    auto target = [&](unsigned int addr) {
+        if(addr > 0xFFE) return;
+        if(!leader[addr]) work.push_back(static_cast<unsigned short>(addr));
+        leader[addr] = true;
+    };
+
+    target(0x200);
+    while(!work.empty()) {
+        unsigned int addr = work.back();
+        work.pop_back();
+
+        while(addr <= 0xFFE && !reached[addr]) {
+            reached[addr] = true;
+            instruction in = chip8aot::decode(r.opcode(addr));
+
+            if(in.handler == h1NNN) { target(in.nnn); break; }
+            if(in.handler == h2NNN) { target(in.nnn); target(addr + 2); break; }
+            if(in.handler == h00EE || in.handler == hBNNN || in.handler == hUnknown) break;
+            if(terminator(in.handler)) { target(addr + 2); target(addr + 4); break; }
+            if(in.handler == hFX0A) { target(addr + 2); break; }
+            addr += 2;
+        }
+    }
+}
+
+static vector<basicBlock> findBlocks(const rom& r)
+{
+    vector<bool> reached(4096), leader(4096);
+    traceFlow(r, reached, leader);
+
+    vector<basicBlock> blocks;
+    for(unsigned int start = 0; start <= 0xFFE; ++start) {
+        if(!leader[start] || !reached[start]) continue;
+
+        // a block runs until a terminator, an untranslatable instruction or the next leader
+        unsigned int addr = start;
+        while(addr <= 0xFFE) {
+            basicBlock b;
+            b.addr = static_cast<unsigned short>(addr);
+            for(;;) {
+                instruction in = chip8aot::decode(r.opcode(addr));
+                if(!translatable(in.handler)) break;
+                b.code.push_back(static_cast<unsigned short>(addr));
+                addr += 2;
+                if(terminator(in.handler) || b.code.size() == maxBlockLength) break;
+                if(addr > 0xFFE || leader[addr] || !reached[addr]) break;
+            }
+            if(b.code.empty()) break;
+
+            b.end = static_cast<unsigned short>(b.code.back() + 2);
+            blocks.push_back(b);
+
+            // continue an overlong block as a new one
+            instruction last = chip8aot::decode(r.opcode(b.code.back()));
+            if(b.code.size() < maxBlockLength || terminator(last.handler)) break;
+            if(addr > 0xFFE || leader[addr] || !reached[addr]) break;
+        }
+    }
+    return blocks;
+}
+
+static void printListing(const rom& r, const vector<basicBlock>& blocks)
+{
+    printf("; contentHash %016llx, %zu blocks\n", (unsigned long long)r.hash, blocks.size());
+    for(const basicBlock& b : blocks) {
+        printf("\nblock_%03X:\n", b.addr);
+        for(unsigned short addr : b.code) {
+            printf("    %03X  %04X  %s\n", addr, r.opcode(addr), disassemble(r.opcode(addr)).c_str());
+        }
+        instruction next = chip8aot::decode(r.opcode(b.end));
+        if(!translatable(next.handler) && !terminator(chip8aot::decode(r.opcode(b.code.back())).handler)) {
+            printf("    %03X  %04X  %s  ; interpreted\n", b.end, r.opcode(b.end), disassemble(r.opcode(b.end)).c_str());
+        }
+    }
+}
+
+// the C++ for one instruction at position i of a block of n
+static string translate(const rom& r, unsigned short addr, size_t i, size_t n)
+{
+    instruction in = chip8aot::decode(r.opcode(addr));
+    char text[160];
+    int x = in.x, y = in.y;
+
+    switch(in.handler) {
+    case h6XNN: snprintf(text, sizeof(text), "V[0x%X] = 0x%02X;", x, in.nn); break;
+    case h7XNN: snprintf(text, sizeof(text), "V[0x%X] += 0x%02X;", x, in.nn); break;
+    case h8XY0: snprintf(text, sizeof(text), "V[0x%X] = V[0x%X];", x, y); break;
+    case h8XY1: snprintf(text, sizeof(text), "V[0x%X] |= V[0x%X];", x, y); break;
+    case h8XY2: snprintf(text, sizeof(text), "V[0x%X] &= V[0x%X];", x, y); break;
+    case h8XY3: snprintf(text, sizeof(text), "V[0x%X] ^= V[0x%X];", x, y); break;
+    case h8XY4:
+        snprintf(text, sizeof(text), "V[0xF] = (V[0x%X] > (0xFF - V[0x%X])) ? 1 : 0; V[0x%X] += V[0x%X];", y, x, x, y);
+        break;
+    case h8XY5:
+        snprintf(text, sizeof(text), "V[0xF] = (V[0x%X] > V[0x%X]) ? 0 : 1; V[0x%X] -= V[0x%X];", y, x, x, y);
+        break;
+    case h8XY6: snprintf(text, sizeof(text), "V[0xF] = V[0x%X] & 0x1; V[0x%X] >>= 1;", x, x); break;
+    case h8XY7:
+        snprintf(text, sizeof(text), "V[0xF] = (V[0x%X] > V[0x%X]) ? 0 : 1; V[0x%X] = V[0x%X] - V[0x%X];", x, y, x, y, x);
+        break;
+    case h8XYE: snprintf(text, sizeof(text), "V[0xF] = V[0x%X] >> 7; V[0x%X] <<= 1;", x, x); break;
+    case hANNN: snprintf(text, sizeof(text), "*m.I = 0x%03X;", in.nnn); break;
+
+    case h1NNN: snprintf(text, sizeof(text), "*m.pc = 0x%03X; return %zu;", in.nnn, n); break;
+    case h3XNN:
+        snprintf(text, sizeof(text), "*m.pc = (V[0x%X] == 0x%02X) ? 0x%03X : 0x%03X; return %zu;", x, in.nn, addr + 4, addr + 2, n);
+        break;
+    case h4XNN:
+        snprintf(text, sizeof(text), "*m.pc = (V[0x%X] != 0x%02X) ? 0x%03X : 0x%03X; return %zu;", x, in.nn, addr + 4, addr + 2, n);
+        break;
+    case h5XY0:
+        snprintf(text, sizeof(text), "*m.pc = (V[0x%X] == V[0x%X]) ? 0x%03X : 0x%03X; return %zu;", x, y, addr + 4, addr + 2, n);
+        break;
+    case h9XY0:
+        snprintf(text, sizeof(text), "*m.pc = (V[0x%X] != V[0x%X]) ? 0x%03X : 0x%03X; return %zu;", x, y, addr + 4, addr + 2, n);
+        break;
+
+    // timers: bring the clock up to this instruction first
+    case hFX07: case hFX15: case hFX18:
+        snprintf(text, sizeof(text), "m.sync(%zu); m.step(0x%03X);", i, addr);
+        break;
+
+    // stores may overwrite this very block
+    case hFX33: case hFX55:
+        snprintf(text, sizeof(text), "m.step(0x%03X); if(m.stale) return %zu;", addr, i + 1);
+        break;
+
+    default:
+        if(terminator(in.handler)) snprintf(text, sizeof(text), "m.step(0x%03X); return %zu;", addr, n);
+        else snprintf(text, sizeof(text), "m.step(0x%03X);", addr);
+        break;
+    }
+    return text;
+}
+
+static void printSource(const rom& r, const vector<basicBlock>& blocks, const string& symbol, const char* path)
+{
+    printf("// Generated by c8aot from %s (contentHash %016llx). Do not edit.\n", path, (unsigned long long)r.hash);
+    printf("//\n//     extern const chip8aot::program %s;\n//     c8.enableAot(&%s);\n\n", symbol.c_str(), symbol.c_str());
+    printf("#include \"chip8.h\"\n\nnamespace {\n");
+
+    for(const basicBlock& b : blocks) {
+        size_t n = b.code.size();
+        vector<string> lines;
+        bool usesV = false;
+        for(size_t i = 0; i < n; ++i) {
+            lines.push_back(translate(r, b.code[i], i, n));
+            usesV = usesV || lines.back().find("V[") != string::npos;
+        }
+
+        printf("\nunsigned long block_%03X(chip8aot::machine& m)\n{\n", b.addr);
+        if(usesV) printf("    unsigned char* V = m.V;\n");
+        for(size_t i = 0; i < n; ++i) {
+            unsigned short addr = b.code[i];
+            printf("    %-72s // %03X  %s\n", lines[i].c_str(), addr, disassemble(r.opcode(addr)).c_str());
+        }
+        if(!terminator(chip8aot::decode(r.opcode(b.code.back())).handler)) {
+            printf("    *m.pc = 0x%03X;\n    return %zu;\n", b.end, n);
+        }
+        printf("}\n");
+    }
+
+    printf("\nconst chip8aot::block blocks[] = {\n");
+    for(const basicBlock& b : blocks) {
+        printf("    { 0x%03X, 0x%03X, %zu, block_%03X },\n", b.addr, b.end, b.code.size(), b.addr);
+    }
+    printf("};\n\n}\n\n");
+    printf("extern const chip8aot::program %s;\n", symbol.c_str());
+    printf("const chip8aot::program %s = { 0x%016llxULL, blocks, sizeof(blocks) / sizeof(blocks[0]) };\n",
+           symbol.c_str(), (unsigned long long)r.hash);
+}
+
+// PONG -> PONG_aot, roms/space-invaders.ch8 -> space_invaders_aot
+static string symbolFor(const string& path)
+{
+    string name = path.substr(path.find_last_of('/') + 1);
+    name = name.substr(0, name.find('.'));
+
+    string symbol;
+    for(char c : name) symbol += isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    if(symbol.empty() || isdigit(static_cast<unsigned char>(symbol[0]))) symbol = "rom_" + symbol;
+    return symbol + "_aot";
+}
+
+int main(int argc, char **argv)
+{
+    bool listing = argc > 1 && strcmp(argv[1], "--disasm") == 0;
+    int first = listing ? 2 : 1;
+    if(argc <= first) {
+        cerr << "usage: " << argv[0] << " --disasm <rom>" << endl;
+        cerr << "       " << argv[0] << " <rom> [symbol] > rom.cpp" << endl;
+        return 1;
+    }
+
+    rom r;
+    if(!readRom(argv[first], r)) return 1;
+    vector<basicBlock> blocks = findBlocks(r);
+
+    if(listing) printListing(r, blocks);
+    else printSource(r, blocks, (argc > first + 1) ? argv[first + 1] : symbolFor(argv[first]), argv[first]);
+    return 0;
+}
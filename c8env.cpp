@@ -0,0 +1,93 @@
+#include "c8env.h"
+#include "chip8env.h"
+#include <iostream>
+#include <string>
+using namespace std;
+
+static_assert(C8ENV_REGISTER == watchV, "register address space differs from chip8env's");
+static_assert(C8ENV_REWARD == watchReward && C8ENV_DONE_EQUALS == watchDoneEquals &&
+              C8ENV_DONE_CHANGED == watchDoneChanged, "rule kinds differ from chip8env's");
+
+struct c8env {
+    chip8roms roms;
+    unique_ptr<chip8env> env;
+};
+
+c8env* c8env_create(const char* rom, size_t count, int observation, uint64_t seed, const char* variantName)
+{
+    chip8variant variant = variantChip8;
+    if(variantName && !variantFromName(variantName, variant)) {
+        cerr << "Unknown variant " << variantName << endl;
+        return nullptr;
+    }
+
+    unique_ptr<c8env> e(new c8env());
+    string error;
+    const romImage* image = e->roms.open(rom, error);
+    if(!image) {
+        cerr << error << endl;
+        return nullptr;
+    }
+
+    chip8env::observation format = observation == C8ENV_BYTE_PLANES ? chip8env::bytePlanes : chip8env::packedBits;
+    e->env.reset(new chip8env(count, format, seed));
+    if(!e->env->load(*image, variant)) {
+        cerr << "Could not load " << rom << endl;
+        return nullptr;
+    }
+    return e.release();
+}
+
+void c8env_destroy(c8env* e)
+{
+    delete e;
+}
+
+int c8env_add_rule(c8env* e, int kind, unsigned int address, unsigned int value, float scale)
+{
+    if(kind < C8ENV_REWARD || kind > C8ENV_DONE_CHANGED) return -1;
+    if(address > 0xFFF && (address < C8ENV_REGISTER || address > C8ENV_REGISTER + 0xF)) return -1;
+
+    watchRule rule;
+    rule.kind = static_cast<watchKind>(kind);
+    rule.address = static_cast<uint16_t>(address);
+    rule.value = static_cast<uint8_t>(value);
+    rule.scale = scale;
+    e->env->addRule(rule);
+    return 0;
+}
+
+void c8env_reset(c8env* e)
+{
+    e->env->reset();
+}
+
+void c8env_step(c8env* e, const uint16_t* actions, unsigned int frames)
+{
+    e->env->step(actions, frames);
+}
+
+size_t c8env_size(const c8env* e)
+{
+    return e->env->size();
+}
+
+size_t c8env_observation_size(const c8env* e)
+{
+    return e->env->observationSize();
+}
+
+const unsigned char* c8env_observations(const c8env* e)
+{
+    return e->env->observations();
+}
+
+const float* c8env_rewards(const c8env* e)
+{
+    return e->env->rewards();
+}
+
+const uint8_t* c8env_dones(const c8env* e)
+{
+    return e->env->dones();
+}
@@ -0,0 +1,53 @@
+/*
+ * C interface to chip8env, for training code in other languages. Every
+ * buffer returned points into the environment and stays valid (at the
+ * same address) until c8env_destroy, so callers can wrap them once,
+ * zero-copy, and read them after every step.
+ */
+
+#ifndef CHIP8_C8ENV_H
+#define CHIP8_C8ENV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct c8env c8env;
+
+/* observation formats */
+#define C8ENV_PACKED_BITS   0   /* 32 uint64 rows per instance, bit 63 = column 0 */
+#define C8ENV_BYTE_PLANES   1   /* 64 * 32 bytes per instance, 1 = lit */
+
+/* watch rule kinds and the register address space */
+#define C8ENV_REWARD        0   /* reward += scale * signed change */
+#define C8ENV_DONE_EQUALS   1   /* done when the byte equals value */
+#define C8ENV_DONE_CHANGED  2   /* done when the byte leaves its starting value */
+#define C8ENV_REGISTER      0x1000  /* address of VX is C8ENV_REGISTER + x */
+
+/* Variant names are those of chip8quirks.h: "chip8", "cosmac",
+ * "schip-quirks" and "xochip-quirks"; NULL means chip8. Returns NULL,
+ * with a message on stderr, when the ROM can't be loaded or the
+ * variant is unknown. */
+c8env* c8env_create(const char* rom, size_t count, int observation, uint64_t seed, const char* variant);
+void c8env_destroy(c8env*);
+
+/* 0 on success, -1 for an unknown kind or address */
+int c8env_add_rule(c8env*, int kind, unsigned int address, unsigned int value, float scale);
+
+void c8env_reset(c8env*);
+void c8env_step(c8env*, const uint16_t* actions, unsigned int frames);
+
+size_t c8env_size(const c8env*);
+size_t c8env_observation_size(const c8env*);
+const unsigned char* c8env_observations(const c8env*);
+const float* c8env_rewards(const c8env*);
+const uint8_t* c8env_dones(const c8env*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHIP8_C8ENV_H */
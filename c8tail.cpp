@@ -0,0 +1,89 @@
+//
+// Follows the frames a chip8 publishes to shared memory.
+//
+// usage: c8tail [--display] [--count n] <name>
+//
+// Prints one line per frame as the publisher (chip8 or headless with
+// --publish <name>) produces them: frame number, cycle count, PC, I,
+// timers and V0-VF, and with --display the screen as text. Starts at
+// the newest frame; frames the ring overwrote before they could be read
+// are reported as skipped. Stops after n frames, or runs until killed.
+//
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "chip8shm.h"
+using namespace std;
+
+static void printFrame(const shmFrame& f, bool display)
+{
+    printf("frame %llu cycle %llu pc 0x%03x i 0x%03x dt %u st %u v",
+           (unsigned long long)f.number, (unsigned long long)f.cycle, f.programCount, f.indexReg,
+           f.delayTimer, f.soundTimer);
+    for(int i = 0; i < 16; ++i) printf(" %02x", f.V[i]);
+    printf("%s\n", f.faulted ? " faulted" : "");
+
+    if(!display) return;
+    char line[65];
+    line[64] = '\0';
+    for(int y = 0; y < 32; ++y) {
+        for(int x = 0; x < 64; ++x) line[x] = ((f.display[y] >> (63 - x)) & 1) ? '#' : '.';
+        printf("%s\n", line);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool display = false;
+    unsigned long long count = 0;
+    const char* name = nullptr;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--display") == 0) display = true;
+        else if(strcmp(argv[i], "--count") == 0 && i + 1 < argc) count = strtoull(argv[++i], nullptr, 10);
+        else name = argv[i];
+    }
+    if(!name) {
+        cerr << "usage: " << argv[0] << " [--display] [--count n] <name>" << endl;
+        return 2;
+    }
+
+    chip8subscriber frames;
+    if(!frames.open(name)) return 2;
+
+    uint64_t next = frames.published();
+    if(next > 0) --next;
+    unsigned long long shown = 0;
+    shmFrame f;
+
+    while(count == 0 || shown < count) {
+        uint64_t published = frames.published();
+        if(next >= published) {
+            // nothing new; a frame is 16 ms, so polling every ms is plenty
+            fflush(stdout);
+            this_thread::sleep_for(chrono::milliseconds(1));
+            continue;
+        }
+
+        // too far behind: jump to the oldest frame still in the ring
+        uint64_t oldest = published > frames.slotCount() ? published - frames.slotCount() : 0;
+        if(next < oldest) {
+            printf("skipped %llu frames\n", (unsigned long long)(oldest - next));
+            next = oldest;
+        }
+
+        if(frames.read(next, f)) {
+            printFrame(f, display);
+            ++shown;
+        }
+        else {
+            printf("skipped 1 frame\n");
+        }
+        ++next;
+    }
+    return 0;
+}
@@ -1,7 +1,51 @@
 #include "chip8.h"
+#include "chip8debug.h"
 #include <iostream>
+#include <cstring>
 using namespace std;
 
+template<class Quirks>
+const chip8::handlerFn chip8::dispatchTable<Quirks>::handlers[] = {
+    &chip8::opUnknown,  // hDecode is never dispatched
+    &chip8::op00E0, &chip8::op00EE, &chip8::op1NNN, &chip8::op2NNN, &chip8::op3XNN,
+    &chip8::op4XNN, &chip8::op5XY0, &chip8::op6XNN, &chip8::op7XNN,
+    &chip8::op8XY0, &chip8::op8XY1<Quirks>, &chip8::op8XY2<Quirks>, &chip8::op8XY3<Quirks>, &chip8::op8XY4,
+    &chip8::op8XY5, &chip8::op8XY6<Quirks>, &chip8::op8XY7, &chip8::op8XYE<Quirks>,
+    &chip8::op9XY0, &chip8::opANNN, &chip8::opBNNN<Quirks>, &chip8::opCXNN, &chip8::opDXYN<Quirks>,
+    &chip8::opEX9E, &chip8::opEXA1,
+    &chip8::opFX07, &chip8::opFX0A, &chip8::opFX15, &chip8::opFX18, &chip8::opFX1E,
+    &chip8::opFX29, &chip8::opFX33, &chip8::opFX55<Quirks>, &chip8::opFX65<Quirks>,
+    &chip8::opUnknown, &chip8::opDebug
+};
+
+const unsigned char chip8::chip8_fontset[80] =
+        {
+                0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+                0x20, 0x60, 0x20, 0x20, 0x70, // 1
+                0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+                0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+                0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+                0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+                0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+                0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+                0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+                0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+                0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+                0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+                0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+                0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+                0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+                0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+        };
+
+chip8::chip8()
+        : ram(make_shared<chip8memory>()),
+          memory(ram->bytes),
+          cache(ram->cache)
+{
+    initialize();
+}
+
 void chip8::initialize()
 {
     // initialize registers/memory
@@ -10,366 +54,1101 @@ void chip8::initialize()
     indexReg            = 0;
     stackPointer        = 0;
 
-    for(int i = 0; i < 2048; ++i) gfx[i] = 0;                       // clear display
+    for(int i = 0; i < 32; ++i) display[i] = 0;                     // clear display
+    for(int i = 0; i < 32; ++i) presented[i] = ~0ULL;               // nothing presented yet
     for(int i = 0; i < 16; ++i) stack[i] = 0;                       // clear stack
     for(int i = 0; i < 16; ++i) keypad[i] = V[i] = 0;               // clear keypad
-    for(int i = 0; i < 4096; ++i) memory[i] = 0;                    // clear memory
-    for(int i = 0; i < 80; ++i){ memory[i] = chip8_fontset[i]; }    // load fontset
+    unshare();
+    memcpy(memory, chip8_fontset, sizeof(chip8_fontset));           // load fontset
+    memset(memory + 80, 0, 4096 - 80);                              // clear memory
+    memset(cache, 0, 4096 * sizeof(instruction));                   // drop decoded instructions (hDecode is 0)
+    memoryHash = memoryKeys(chip8_fontset, sizeof(chip8_fontset), 0);
+    memset(rowHashes, 0, sizeof(rowHashes));
+    displayHash = 0;
+    staleRows = 0xFFFFFFFF;
+    ram->complete = false;
+    if(jit) jit->flush();                                           // drop compiled blocks
+    if(aot) aot->reset();                                           // translated blocks are valid again
 
-    // reset timers
+    // reset timers and start a fresh frame
     delay_timer = sound_timer = 0;
+    frameCycle = 0;
+    cycleCount = 0;
+    romHash = 0;
+    faulted = false;
+#if CHIP8_TRACE_LEVEL > 0
+    trace.clear();
+#endif
+#if CHIP8_PROFILE
+    profile.clear();
+#endif
 
-    drawFlag = true;
-    srand(time(NULL));
+    touchedRows = 0xFFFFFFFF;
+    rngState = seedRandom(rngSeed);
+}
+
+void chip8::seed(uint64_t value)
+{
+    rngSeed = value;
+    rngState = seedRandom(value);
 }
 
 void chip8::emulateCycle()
 {
-    // fetch opcode
-    opcode = memory[programCount] << 8 | memory[programCount + 1];
-    printf("%X\n", opcode);
-    programCount+=2;
+    step();
+    advanceClock(1);
+}
+
+// run a batch of cycles, through translated or compiled blocks when
+// the AOT program or the JIT has one and the interpreter otherwise
+void chip8::runCycles(unsigned long cycles)
+{
+    if(debugger && debugger->active()) {
+        debugCycles(cycles);
+        return;
+    }
+
+#if CHIP8_PROFILE
+    profile.startRun();
+#endif
+
+#if CHIP8_TRACE_LEVEL == 0 && !CHIP8_PROFILE
+    bool native = variant == variantChip8;     // JIT and AOT code has chip8's quirks
+#endif
+
+    while(cycles > 0) {
+#if CHIP8_TRACE_LEVEL == 0 && !CHIP8_PROFILE
+        unsigned char next = cache[programCount & 0xFFF].handler;
+        if(idleSkip && (next == h1NNN || next == hFX07 || next == hFX0A || next == hEX9E || next == hEXA1)) {
+            unsigned long ran = skipIdle(cycles);
+            if(ran > 0) {
+                cycles -= ran;
+                continue;
+            }
+        }
+        if(aot && native) {
+            unsigned long ran = aot->execute(*this, cycles);
+            if(ran > 0) {
+                cycles -= ran;
+                continue;
+            }
+        }
+        if(jit && native) {
+            unsigned long ran = jit->execute(*this, cycles);
+            if(ran > 0) {
+                advanceClock(ran);
+                cycles -= ran;
+                continue;
+            }
+        }
+#endif
+
+        step();
+        advanceClock(1);
+        --cycles;
+    }
+
+#if CHIP8_PROFILE
+    profile.endRun();
+#endif
+}
+
+// interpreter loop for an instance whose debugger has something set;
+// an entry it stops at ends the run before the cycle is used
+void chip8::debugCycles(unsigned long cycles)
+{
+    while(cycles > 0 && !debugger->paused()) {
+        step();
+        if(debugger->paused()) break;
+        advanceClock(1);
+        --cycles;
+    }
+}
+
+// fetch and execute one instruction through the interpreter;
+// handlers advance programCount themselves
+inline void chip8::step()
+{
+    const instruction& in = fetch();
+    opcode = in.opcode;
 
-    // process (decode and execute) opcode
-    decode(opcode);
+#if CHIP8_PROFILE
+    profile.count(in.handler, programCount);
+#endif
 
-    // update timers
+#if CHIP8_TRACE_LEVEL > 0
+    unsigned short pc = programCount;
+    unsigned char before[16];
+    bool wasFaulted = faulted;
+    memcpy(before, V, sizeof(V));
+
+    execute(in);
+
+    trace.record(pc, opcode, indexReg, before, V);
+    if(faulted && !wasFaulted) {
+        trace.dump("chip8-fault.trace");
+    }
+#else
+    execute(in);
+#endif
+}
+
+bool chip8::dumpTrace(const std::string& path) const
+{
+#if CHIP8_TRACE_LEVEL > 0
+    return trace.dump(path.c_str());
+#else
+    return false;
+#endif
+}
+
+void chip8::saveState(chip8state& s) const
+{
+    s.tag = stateTag;
+    s.version = stateVersion;
+    s.cyclesPerFrame = cyclesPerFrame;
+    s.frameCycle = frameCycle;
+    s.rng = rngState;
+    s.cycleCount = cycleCount;
+    s.romHash = romHash;
+    memcpy(s.display, display, sizeof(display));
+    memcpy(s.stack, stack, sizeof(stack));
+    s.indexReg = indexReg;
+    s.programCount = programCount;
+    s.stackPointer = stackPointer;
+    s.flags = faulted ? stateFaulted : 0;
+    memcpy(s.V, V, sizeof(V));
+    memcpy(s.keypad, keypad, sizeof(keypad));
+    s.delay_timer = delay_timer;
+    s.sound_timer = sound_timer;
+    s.variant = variant;
+    memset(s.reserved, 0, sizeof(s.reserved));
+    memcpy(s.memory, memory, 4096);
+}
+
+bool chip8::loadState(const chip8state& s)
+{
+    if(!stateValid(s)) return false;
+
+    // only code that actually differs needs decoding again
+    if(memcmp(memory, s.memory, 4096) != 0) {
+        unshare();
+        for(int addr = 0; addr < 4096; addr += 8) {
+            uint64_t was, now;
+            memcpy(&was, memory + addr, 8);
+            memcpy(&now, s.memory + addr, 8);
+            if(was == now) continue;
+            invalidate(addr, 8);
+            for(int i = addr; i < addr + 8; ++i) memoryHash ^= memoryKey(i, memory[i]) ^ memoryKey(i, s.memory[i]);
+        }
+        memcpy(memory, s.memory, 4096);
+    }
+
+    cyclesPerFrame = s.cyclesPerFrame ? s.cyclesPerFrame : defaultCyclesPerFrame;
+    frameCycle = s.frameCycle % cyclesPerFrame;
+    rngState = s.rng ? s.rng : seedRandom(rngSeed);
+    cycleCount = s.cycleCount;
+    romHash = s.romHash;
+    memcpy(display, s.display, sizeof(display));
+    staleRows = 0xFFFFFFFF;
+    memcpy(stack, s.stack, sizeof(stack));
+    indexReg = s.indexReg;
+    programCount = s.programCount;
+    stackPointer = s.stackPointer;
+    faulted = (s.flags & stateFaulted) != 0;
+    memcpy(V, s.V, sizeof(V));
+    memcpy(keypad, s.keypad, sizeof(keypad));
+    delay_timer = s.delay_timer;
+    sound_timer = s.sound_timer;
+    setVariant(static_cast<chip8variant>(s.variant));
+
+    touchedRows = 0xFFFFFFFF;
+    return true;
+}
+
+bool chip8::saveState(const std::string& path) const
+{
+    chip8state s;
+    saveState(s);
+    return writeState(path.c_str(), s);
+}
+
+bool chip8::loadState(const std::string& path)
+{
+    chip8state s;
+    return readState(path.c_str(), s) && loadState(s);
+}
+
+bool chip8::writeProfile(const std::string& path) const
+{
+#if CHIP8_PROFILE
+    FILE* out = fopen(path.c_str(), "w");
+    if(!out) return false;
+
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if(json) profile.writeJson(out);
+    else profile.writeCsv(out);
+
+    return fclose(out) == 0;
+#else
+    return false;
+#endif
+}
+
+// run to the end of the current 60 Hz frame
+void chip8::runFrame()
+{
+    runCycles(cyclesPerFrame - frameCycle);
+}
+
+void chip8::setCyclesPerFrame(unsigned int cycles)
+{
+    cyclesPerFrame = (cycles > 0) ? cycles : 1;
+    if(frameCycle >= cyclesPerFrame) frameCycle = 0;
+}
+
+void chip8::enableJit(bool enable)
+{
+    if(enable && !jit && chip8jit::supported()) {
+        jit.reset(new chip8jit());
+    }
+    else if(!enable) {
+        jit.reset();
+    }
+}
+
+void chip8::enableAot(const chip8aot::program* translated)
+{
+    aot.reset(translated ? new chip8aot(*translated) : nullptr);
+}
+
+void chip8::setVariant(chip8variant v)
+{
+    switch(v) {
+    case variantCosmac: handlers = dispatchTable<cosmacQuirks>::handlers; break;
+    case variantSchipQuirks:  handlers = dispatchTable<schipQuirks>::handlers; break;
+    case variantXochipQuirks: handlers = dispatchTable<xochipQuirks>::handlers; break;
+    default:
+        v = variantChip8;
+        handlers = dispatchTable<chip8Quirks>::handlers;
+    }
+    variant = v;
+}
+
+// count executed cycles and tick the timers on every frame boundary
+void chip8::advanceClock(unsigned long cycles)
+{
+    cycleCount += cycles;
+    frameCycle += cycles;
+    while(frameCycle >= cyclesPerFrame) {
+        frameCycle -= cyclesPerFrame;
+        updateTimers();
+    }
+}
+
+// one 60 Hz tick of both timers
+void chip8::updateTimers()
+{
     if(delay_timer > 0){
         --delay_timer;
     }
 
     if(sound_timer > 0) {
-        if(sound_timer == 1) {
-            printf("BEEP!\n");
-        }
         --sound_timer;
     }
 }
 
-bool chip8::loadGame(std::string filename)
+// fetch the decoded instruction at programCount, decoding it on first use
+instruction& chip8::fetch()
+{
+    return decodedAt(programCount);
+}
+
+instruction& chip8::decodedAt(unsigned short addr)
+{
+    instruction& in = cache[addr & 0xFFF];
+    if(in.handler == hDecode) {
+        in = predecode(memory[addr & 0xFFF] << 8 | memory[(addr + 1) & 0xFFF]);
+        if(debugger && debugger->marks(addr, in.handler)) in.handler = hDebug;
+    }
+    return in;
+}
+
+// Run out an idle loop at programCount within the cycle budget, as
+// described in chip8.h. Only whole iterations are skipped; returns the
+// number of cycles run, 0 when programCount isn't in an idle loop.
+unsigned long chip8::skipIdle(unsigned long budget)
 {
-    // open file, check if appropriate size
-    ifstream input(filename, std::ios::binary | std::ios::ate);
-    if(input){
-        if(input.tellg() > (4096 - 512)){
-            cout << "File too large; not enough memory available." << endl;
-            return false;
+    unsigned short pc = programCount & 0xFFF;
+    const instruction& first = decodedAt(pc);
+
+    switch(first.handler) {
+    case h1NNN:
+        if(first.nnn != pc) return 0;
+        opcode = first.opcode;
+        advanceClock(budget);
+        return budget;
+
+    case hFX0A:
+        for(int i = 0; i < 16; ++i) {
+            if(keypad[i] != 0) return 0;
         }
-        else {
-            input.seekg(0, input.beg);
+        opcode = first.opcode;
+        advanceClock(budget);
+        return budget;
+
+    case hEX9E:
+    case hEXA1:
+    {
+        const instruction& jump = decodedAt(pc + 2);
+        if(jump.handler != h1NNN || jump.nnn != pc) return 0;
+
+        // the keypad only changes between runCycles calls
+        bool pressed = keypad[V[first.x] & 0xF] != 0;
+        if(pressed == (first.handler == hEX9E)) return 0;
+
+        unsigned long ran = budget - budget % 2;
+        if(ran > 0) {
+            opcode = jump.opcode;
+            advanceClock(ran);
         }
+        return ran;
     }
 
-    // copy data into buffer, then buffer into system memory
-    vector<char> buffer((istreambuf_iterator<char>(input)), (istreambuf_iterator<char>()));
-    for(int i = 0; i < buffer.size(); ++i){
-        memory[i + 512] = buffer.at(i); // memory starts at 0x200
+    case hFX07:
+    {
+        const instruction& test = decodedAt(pc + 2);
+        const instruction& jump = decodedAt(pc + 4);
+        if((test.handler != h3XNN && test.handler != h4XNN) || test.x != first.x) return 0;
+        if(jump.handler != h1NNN || jump.nnn != pc) return 0;
+
+        unsigned long ran = 0;
+        for(;;) {
+            bool loops = (test.handler == h3XNN) ? (delay_timer != test.nn) : (delay_timer == test.nn);
+            if(!loops) break;
+
+            // iterations whose FX07 still reads the current timer value;
+            // a stopped timer never changes again
+            unsigned long iterations = (budget - ran) / 3;
+            if(delay_timer > 0) {
+                unsigned long untilTick = cyclesPerFrame - frameCycle;
+                iterations = min(iterations, (untilTick + 2) / 3);
+            }
+            if(iterations == 0) break;
+
+            V[first.x] = delay_timer;
+            opcode = jump.opcode;
+            advanceClock(iterations * 3);
+            ran += iterations * 3;
+        }
+        return ran;
     }
 
-    input.close();
-    return true;
+    default:
+        return 0;
+    }
 }
 
-void chip8::setKeypad()
+// predict how long skipIdle would keep the instance idle; decodes from
+// memory directly so that querying leaves the cache alone
+unsigned long chip8::idleCycles() const
 {
+    auto at = [this](unsigned short addr) {
+        return predecode(memory[addr & 0xFFF] << 8 | memory[(addr + 1) & 0xFFF]);
+    };
 
-}
+    unsigned short pc = programCount & 0xFFF;
+    instruction first = at(pc);
 
-void chip8::decode(unsigned short op)
-{
-    switch(op & 0xF000) {
-    case 0x0000:
-        switch(opcode & 0x000F) {
-        case 0x0000: // [00E0] clears the screen
-            for(int i = 0; i < 2048; ++i) {
-                gfx[i] = 0;
-            }
-            drawFlag = true;
-            break;
-        case 0x000E: // [00EE] returns from subroutine
-            --stackPointer;                         // 16 levels of stack, decrease to avoid overwrite
-            programCount = stack[stackPointer];     // put stored return address from stack into programCount
-            programCount += 2;                      // increase programCount
-            break;
-        default:
-            printf("Unknown opcode: 0x%X\n", opcode);
-        }
+    // stopped on the jump back to an idle loop; timer waits still count
+    // from now, since the tick that ends them doesn't move
+    if(first.handler == h1NNN && first.nnn != pc) {
+        pc = first.nnn;
+        first = at(pc);
+    }
+
+    unsigned long idle = 0;
+    switch(first.handler) {
+    case h1NNN:
+        if(first.nnn == pc) idle = idleForever;
         break;
 
-    case 0x1000: // [1xxx] jumps to address xxx
-        programCount = opcode & 0x0FFF;
+    case hFX0A:
+        idle = idleForever;
+        for(int i = 0; i < 16; ++i) {
+            if(keypad[i] != 0) idle = 0;
+        }
         break;
 
-    case 0x2000: // [2xxx] calls the subroutine at address xxx
-        stack[stackPointer] = programCount;
-        ++stackPointer;
-        programCount = opcode & 0x0FFF;
+    case hEX9E:
+    case hEXA1:
+    {
+        instruction jump = at(pc + 2);
+        bool pressed = keypad[V[first.x] & 0xF] != 0;
+        if(jump.handler == h1NNN && jump.nnn == pc && pressed != (first.handler == hEX9E)) {
+            idle = idleForever;
+        }
+    }
         break;
 
-    case 0x3000: // [3Xxx] skips next instruction if VX doesn't equal xx
-        if(V[(opcode & 0x0f00) >> 8] == (opcode & 0x00FF)) {
-            programCount += 4;
+    case hFX07:
+    {
+        instruction test = at(pc + 2);
+        instruction jump = at(pc + 4);
+        if((test.handler != h3XNN && test.handler != h4XNN) || test.x != first.x) break;
+        if(jump.handler != h1NNN || jump.nnn != pc) break;
+
+        // timer ticks until FX07 reads a value that ends the loop
+        unsigned long ticks;
+        if(test.handler == h3XNN) {
+            if(delay_timer == test.nn) break;
+            if(delay_timer < test.nn) {
+                idle = idleForever;
+                break;
+            }
+            ticks = delay_timer - test.nn;
         }
         else {
-            programCount += 2;
+            if(delay_timer != test.nn) break;
+            if(delay_timer == 0) {
+                idle = idleForever;
+                break;
+            }
+            ticks = 1;
         }
+        idle = (cyclesPerFrame - frameCycle) + (ticks - 1) * cyclesPerFrame;
+    }
         break;
 
-    case 0x4000: // [4Xxx] skips the next instruction if VX doesn't equal xx
-        if(V[(opcode & 0x0F00) >> 8] != (opcode & 0x00FF))
-            programCount += 4;
-        else
-            programCount += 2;
+    default:
         break;
+    }
+    return idle;
+}
 
-    case 0x5000: // [5XY0] skips the next instruction if VX equals VY.
-        if(V[(opcode & 0x0F00) >> 8] == V[(opcode & 0x00F0) >> 4])
-            programCount += 4;
-        else
-            programCount += 2;
-        break;
+bool chip8::loadGame(std::string filename)
+{
+    FILE* input = fopen(filename.c_str(), "rb");
+    if(!input) {
+        cerr << "Could not open " << filename << endl;
+        return false;
+    }
 
-    case 0x6000: // [6Xxx] Sets VX to xx.
-        V[(opcode & 0x0F00) >> 8] = opcode & 0x00FF;
-        programCount += 2;
-        break;
+    // read one byte more than fits to detect oversized files
+    unsigned char buffer[maxRomSize + 1];
+    size_t size = fread(buffer, 1, sizeof(buffer), input);
+    bool failed = ferror(input) != 0;
+    fclose(input);
 
-    case 0x7000: // [7Xxx] Adds xx to VX.
-        V[(opcode & 0x0F00) >> 8] += opcode & 0x00FF;
-        programCount += 2;
-        break;
+    if(failed) {
+        cerr << "Could not read " << filename << endl;
+        return false;
+    }
+    if(size == 0 || size > maxRomSize) {
+        cerr << filename << (size ? " is too large; not enough memory available." : " is empty.") << endl;
+        return false;
+    }
+    return loadProgram(buffer, size);
+}
 
-    case 0x8000:
-        switch(opcode & 0x000F) {
-        case 0x0000: // [8XY0] sets VX to the value of VY
-            V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x00F0) >> 4];
-            programCount += 2;
-            break;
-
-        case 0x0001: // [8XY1] sets VX to "VX OR VY"
-            V[(opcode & 0x0F00) >> 8] |= V[(opcode & 0x00F0) >> 4];
-            programCount += 2;
-            break;
-
-        case 0x0002: // [8XY2] sets VX to "VX AND VY"
-            V[(opcode & 0x0F00) >> 8] &= V[(opcode & 0x00F0) >> 4];
-            programCount += 2;
-            break;
-
-        case 0x0003: // [8XY3] sets VX to "VX XOR VY"
-            V[(opcode & 0x0F00) >> 8] ^= V[(opcode & 0x00F0) >> 4];
-            programCount += 2;
-            break;
-
-        case 0x0004: // [8XY4] adds VY to VX. VF is set to 1 for carry, else 0
-            if(V[(opcode & 0x00F0) >> 4] > (0xFF - V[(opcode & 0x0F00) >> 8])) {
-                V[0xF] = 1; //carry
-            }
-            else {
-                V[0xF] = 0;
-            }
-            V[(opcode & 0x0F00) >> 8] += V[(opcode & 0x00F0) >> 4];
-            programCount += 2;
-            break;
+bool chip8::loadProgram(const unsigned char* program, size_t size)
+{
+    if(size == 0 || size > maxRomSize) return false;
 
-        case 0x0005: // [8XY5] VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there isn't
-            if(V[(opcode & 0x00F0) >> 4] > V[(opcode & 0x0F00) >> 8]) {
-                V[0xF] = 0; // there is a borrow
-            }
-            else {
-                V[0xF] = 1;
-            }
-            V[(opcode & 0x0F00) >> 8] -= V[(opcode & 0x00F0) >> 4];
-            programCount += 2;
-            break;
-
-        case 0x0006: // [8XY6] shifts VX right by one. VF is set to the value of the least significant bit of VX before the shift
-            V[0xF] = V[(opcode & 0x0F00) >> 8] & 0x1;
-            V[(opcode & 0x0F00) >> 8] >>= 1;
-            programCount += 2;
-            break;
-
-        case 0x0007: // [8XY7] sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there isn't
-            if(V[(opcode & 0x0F00) >> 8] > V[(opcode & 0x00F0) >> 4]) {   // VY-VX
-                V[0xF] = 0; // there is a borrow
-            }
-            else {
-                V[0xF] = 1;
-            }
-            V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x00F0) >> 4] - V[(opcode & 0x0F00) >> 8];
-            programCount += 2;
-            break;
-
-        case 0x000E: // [8XYE] shifts VX left by one. VF is set to the value of the most significant bit of VX before the shift
-            V[0xF] = V[(opcode & 0x0F00) >> 8] >> 7;
-            V[(opcode & 0x0F00) >> 8] <<= 1;
-            programCount += 2;
-            break;
-
-        default:
-            printf("Unknown opcode [0x8000]: 0x%X\n", opcode);
+    initialize();
+    memcpy(memory + 512, program, size);    // memory starts at 0x200
+    memoryHash ^= memoryKeys(program, size, 0x200);
+    romHash = contentHash(program, size);
+    return true;
+}
+
+bool chip8::loadImage(const romImage& image)
+{
+    if(image.size == 0 || image.size > maxRomSize) return false;
+
+    initialize();
+    memcpy(memory + 512, image.bytes, image.size);
+    memoryHash ^= image.keys;
+    romHash = image.hash;
+    return true;
+}
+
+void chip8::setKeypad()
+{
+
+}
+
+void chip8::getGfx(unsigned char* out) const
+{
+    for(int y = 0; y < 32; ++y) {
+        for(int x = 0; x < 64; ++x) {
+            out[y * 64 + x] = getPixel(x, y);
         }
-        break;
+    }
+}
+
+uint32_t chip8::damagedRows() const
+{
+    // only rows drawn to since the last acknowledgement can differ
+    uint32_t rows = 0;
+    for(uint32_t touched = touchedRows; touched != 0; touched &= touched - 1) {
+        int row = __builtin_ctz(touched);
+        if(display[row] != presented[row]) rows |= 1u << row;
+    }
+    return rows;
+}
+
+void chip8::acknowledgeDamage()
+{
+    for(uint32_t rows = touchedRows; rows != 0; rows &= rows - 1) {
+        int row = __builtin_ctz(rows);
+        presented[row] = display[row];
+    }
+    touchedRows = 0;
+}
+
+uint32_t chip8::changedRows(const uint64_t* since) const
+{
+    uint32_t rows = 0;
+    for(int i = 0; i < 32; ++i) {
+        rows |= static_cast<uint32_t>(display[i] != since[i]) << i;
+    }
+    return rows;
+}
+
+bool chip8::rowSpan(uint32_t rows, int& first, int& last)
+{
+    if(rows == 0) return false;
+    first = __builtin_ctz(rows);
+    last = 31 - __builtin_clz(rows);
+    return true;
+}
+
+// rehash the rows drawn to since the last call, then fold the registers
+// into the memory and display hashes; stack entries above the stack
+// pointer are dead and left out
+uint64_t chip8::stateHash() const
+{
+    for(uint32_t rows = staleRows; rows != 0; rows &= rows - 1) {
+        int y = __builtin_ctz(rows);
+        uint64_t row = seedRandom(display[y] ^ seedRandom(0x100000 | y));
+        displayHash ^= rowHashes[y] ^ row;
+        rowHashes[y] = row;
+    }
+    staleRows = 0;
+
+    uint64_t words[8] = {};
+    memcpy(&words[0], V, sizeof(V));
+    words[2] = indexReg | static_cast<uint64_t>(programCount) << 16 | static_cast<uint64_t>(stackPointer) << 32 |
+               static_cast<uint64_t>(delay_timer) << 40 | static_cast<uint64_t>(sound_timer) << 48 |
+               static_cast<uint64_t>(variant) << 56 | static_cast<uint64_t>(faulted) << 63;
+    memcpy(&words[3], stack, min<size_t>(stackPointer, 16) * sizeof(stack[0]));
+    words[7] = frameCycle | static_cast<uint64_t>(cyclesPerFrame) << 32;
+
+    // a full splitmix64 round per word: anything weaker lets a change
+    // in one word cancel against a change in the next
+    uint64_t hash = memoryHash ^ displayHash;
+    for(int i = 0; i < 8; ++i) {
+        hash = seedRandom(hash ^ words[i]);
+    }
+    return seedRandom(hash ^ rngState);
+}
+
+// hash of the framebuffer, for comparing runs without keeping frames;
+// a full splitmix64 round per row so that every pixel reaches every bit
+unsigned long long chip8::frameHash() const
+{
+    uint64_t hash = 0;
+    for(int i = 0; i < 32; ++i) {
+        hash = seedRandom(hash ^ display[i]);
+    }
+    return hash;
+}
+
+void chip8::decode(unsigned short op)
+{
+    opcode = op;
+    execute(predecode(op));
+}
+
+void chip8::execute(const instruction& in)
+{
+    (this->*handlers[in.handler])(in);
+}
+
+// drop any decoded instruction that overlaps memory[addr, addr + len)
+void chip8::invalidate(unsigned short addr, unsigned short len)
+{
+    for(int i = addr - 1; i < addr + len; ++i) {
+        cache[i & 0xFFF].handler = hDecode;
+    }
+    ram->complete = false;
+    if(jit) jit->invalidate(addr, len);
+    if(aot) aot->invalidate(addr, len);
+}
+
+// take a private copy of memory (and its decoded instructions) before writing to it
+void chip8::unshare()
+{
+    if(ram.use_count() > 1) {
+        ram = make_shared<chip8memory>(*ram);
+        memory = ram->bytes;
+        cache = ram->cache;
+    }
+}
+
+// mark or unmark every decoded entry after the debugger's breakpoints
+// or watchpoints change
+void chip8::remark()
+{
+    unshare();
+    for(int addr = 0; addr < 4096; ++addr) {
+        instruction& in = cache[addr];
+        if(in.handler == hDecode) continue;
+        in.handler = predecode(in.opcode).handler;
+        if(debugger && debugger->marks(addr, in.handler)) in.handler = hDebug;
+    }
+}
 
-    case 0x9000: // [9XY0] skips the next instruction if VX doesn't equal VY
-        if(V[(opcode & 0x0F00) >> 8] != V[(opcode & 0x00F0) >> 4]){
-            programCount += 4;
+void chip8::fork(chip8& child)
+{
+    // decode everything up front so nobody writes to the block once it's shared
+    if(!ram->complete) {
+        for(int addr = 0; addr < 4096; ++addr) {
+            decodedAt(addr);
         }
-        else {
-            programCount += 2;
+        ram->complete = true;
+    }
+
+    child.ram = ram;
+    child.memory = memory;
+    child.cache = cache;
+    child.jit.reset();
+    child.aot.reset();
+
+    child.opcode = opcode;
+    memcpy(child.display, display, sizeof(display));
+    child.memoryHash = memoryHash;
+    memcpy(child.rowHashes, rowHashes, sizeof(rowHashes));
+    child.displayHash = displayHash;
+    child.staleRows = staleRows;
+    memcpy(child.presented, presented, sizeof(presented));
+    child.touchedRows = touchedRows;
+    child.faulted = faulted;
+    memcpy(child.V, V, sizeof(V));
+    child.indexReg = indexReg;
+    child.programCount = programCount;
+    child.delay_timer = delay_timer;
+    child.sound_timer = sound_timer;
+    child.cyclesPerFrame = cyclesPerFrame;
+    child.idleSkip = idleSkip;
+    child.frameCycle = frameCycle;
+    child.rngSeed = rngSeed;
+    child.rngState = rngState;
+    child.cycleCount = cycleCount;
+    child.romHash = romHash;
+    memcpy(child.stack, stack, sizeof(stack));
+    child.stackPointer = stackPointer;
+    memcpy(child.keypad, keypad, sizeof(keypad));
+    child.setVariant(variant);
+}
+
+void chip8::forkAndRun(vector<unique_ptr<chip8>>& children, const uint16_t* keys, size_t count, unsigned long cycles)
+{
+    while(children.size() < count) children.emplace_back(new chip8());
+
+    for(size_t i = 0; i < count; ++i) {
+        chip8& child = *children[i];
+        fork(child);
+        for(int k = 0; k < 16; ++k) child.keypad[k] = (keys[i] >> k) & 1;
+        child.runCycles(cycles);
+    }
+}
+
+instruction chip8::predecode(unsigned short op)
+{
+    instruction in;
+    in.opcode = op;
+    in.x      = (op & 0x0F00) >> 8;
+    in.y      = (op & 0x00F0) >> 4;
+    in.nn     = op & 0x00FF;
+    in.nnn    = op & 0x0FFF;
+
+    switch(op & 0xF000) {
+    case 0x0000:
+        switch(op & 0x000F) {
+        case 0x0000: in.handler = h00E0; break;
+        case 0x000E: in.handler = h00EE; break;
+        default:     in.handler = hUnknown;
         }
         break;
-
-    case 0xA000: // [Axxx] sets indexReg to the address xxx
-        indexReg = opcode & 0x0FFF;
-        programCount += 2;
+    case 0x1000: in.handler = h1NNN; break;
+    case 0x2000: in.handler = h2NNN; break;
+    case 0x3000: in.handler = h3XNN; break;
+    case 0x4000: in.handler = h4XNN; break;
+    case 0x5000: in.handler = h5XY0; break;
+    case 0x6000: in.handler = h6XNN; break;
+    case 0x7000: in.handler = h7XNN; break;
+    case 0x8000:
+        switch(op & 0x000F) {
+        case 0x0000: in.handler = h8XY0; break;
+        case 0x0001: in.handler = h8XY1; break;
+        case 0x0002: in.handler = h8XY2; break;
+        case 0x0003: in.handler = h8XY3; break;
+        case 0x0004: in.handler = h8XY4; break;
+        case 0x0005: in.handler = h8XY5; break;
+        case 0x0006: in.handler = h8XY6; break;
+        case 0x0007: in.handler = h8XY7; break;
+        case 0x000E: in.handler = h8XYE; break;
+        default:     in.handler = hUnknown;
+        }
         break;
-
-    case 0xB000: // [Bxxx] jumps to the address xxx plus V0
-        programCount = (opcode & 0x0FFF) + V[0];
+    case 0x9000: in.handler = h9XY0; break;
+    case 0xA000: in.handler = hANNN; break;
+    case 0xB000: in.handler = hBNNN; break;
+    case 0xC000: in.handler = hCXNN; break;
+    case 0xD000: in.handler = hDXYN; break;
+    case 0xE000:
+        switch(op & 0x00FF) {
+        case 0x009E: in.handler = hEX9E; break;
+        case 0x00A1: in.handler = hEXA1; break;
+        default:     in.handler = hUnknown;
+        }
         break;
-
-    case 0xC000: // CXxx: Sets VX to a random number and xx
-        V[(opcode & 0x0F00) >> 8] = (rand() % 0xFF) & (opcode & 0x00FF);
-        programCount += 2;
+    case 0xF000:
+        switch(op & 0x00FF) {
+        case 0x0007: in.handler = hFX07; break;
+        case 0x000A: in.handler = hFX0A; break;
+        case 0x0015: in.handler = hFX15; break;
+        case 0x0018: in.handler = hFX18; break;
+        case 0x001E: in.handler = hFX1E; break;
+        case 0x0029: in.handler = hFX29; break;
+        case 0x0033: in.handler = hFX33; break;
+        case 0x0055: in.handler = hFX55; break;
+        case 0x0065: in.handler = hFX65; break;
+        default:     in.handler = hUnknown;
+        }
         break;
+    default:
+        in.handler = hUnknown;
+    }
+    return in;
+}
 
-    case 0xD000:  // draws sprite at corrdinate (VX, VY) that has width of 8 pixels and height
-    {             // of n pixels.
-        unsigned short x = V[(opcode & 0x0F00) >> 8];
-        unsigned short y = V[(opcode & 0x00F0) >> 4];
-        unsigned short height = opcode & 0x000F;
-        unsigned short pixel;
-
-        V[0xF] = 0;
-        for(int yline = 0; yline < height; yline++) {
-            pixel = memory[indexReg + yline];
-            for(int xline = 0; xline < 8; xline++) {
-                if((pixel & (0x80 >> xline)) != 0) {
-                    if(gfx[(x + xline + ((y + yline) * 64))] == 1) {
-                        V[0xF] = 1;
-                    }
-                    gfx[x + xline + ((y + yline) * 64)] ^= 1;
-                }
-            }
-        }
+void chip8::op00E0(const instruction& in) // [00E0] clears the screen
+{
+    memset(display, 0, sizeof(display));
+    touchedRows = staleRows = 0xFFFFFFFF;
+#if CHIP8_PROFILE
+    ++profile.clears;
+#endif
+    programCount += 2;
+}
 
-        drawFlag = true;
-        programCount += 2;
+void chip8::op00EE(const instruction& in) // [00EE] returns from subroutine
+{
+    if(stackPointer == 0) {                 // nothing to return to: fault and stall, like an unknown opcode
+        faulted = true;
+        return;
     }
-        break;
+    --stackPointer;                         // 16 levels of stack, decrease to avoid overwrite
+    programCount = stack[stackPointer];     // put stored return address from stack into programCount
+    programCount += 2;                      // increase programCount
+}
 
-    case 0xE000:
-        switch(opcode & 0x00FF)
-        {
-        case 0x009E: // EX9E: Skips the next instruction if the key stored in VX is pressed
-            if(keypad[V[(opcode & 0x0F00) >> 8]] != 0){
-                programCount += 4;
-            }
-            else{
-                programCount += 2;
-            }
-            break;
+void chip8::op1NNN(const instruction& in) // [1xxx] jumps to address xxx
+{
+    programCount = in.nnn;
+}
 
-        case 0x00A1: // EXA1: Skips the next instruction if the key stored in VX isn't pressed
-            if(keypad[V[(opcode & 0x0F00) >> 8]] == 0){
-                programCount += 4;
-            }
-            else{
-                programCount += 2;
-            }
-            break;
+void chip8::op2NNN(const instruction& in) // [2xxx] calls the subroutine at address xxx
+{
+    if(stackPointer >= 16) {                // a 17th nested call: fault and stall
+        faulted = true;
+        return;
+    }
+    stack[stackPointer] = programCount;
+    ++stackPointer;
+    programCount = in.nnn;
+}
 
-        default:
-            printf ("Unknown opcode [0xE000]: 0x%X\n", opcode);
-        }
-        break;
+void chip8::op3XNN(const instruction& in) // [3Xxx] skips the next instruction if VX equals xx
+{
+    programCount += (V[in.x] == in.nn) ? 4 : 2;
+}
 
-    case 0xF000:
-        switch(opcode & 0x00FF)
-        {
-        case 0x0007: // [FX07] sets VX to the value of the delay timer
-            V[(opcode & 0x0F00) >> 8] = delay_timer;
-            programCount += 2;
-            break;
+void chip8::op4XNN(const instruction& in) // [4Xxx] skips the next instruction if VX doesn't equal xx
+{
+    programCount += (V[in.x] != in.nn) ? 4 : 2;
+}
 
-        case 0x000A: // [FX0A] a key press is awaited, and then stored in VX
-        {
-            bool keyPress = false;
-            for(int i = 0; i < 16; ++i) {
-                if(keypad[i] != 0) {
-                    V[(opcode & 0x0F00) >> 8] = i;
-                    keyPress = true;
-                }
-            }
+void chip8::op5XY0(const instruction& in) // [5XY0] skips the next instruction if VX equals VY.
+{
+    programCount += (V[in.x] == V[in.y]) ? 4 : 2;
+}
 
-            // no keyPress, skip cycle
-            if(!keyPress) return;
+void chip8::op6XNN(const instruction& in) // [6Xxx] Sets VX to xx.
+{
+    V[in.x] = in.nn;
+    programCount += 2;
+}
 
-            programCount += 2;
-        }
-            break;
+void chip8::op7XNN(const instruction& in) // [7Xxx] Adds xx to VX.
+{
+    V[in.x] += in.nn;
+    programCount += 2;
+}
 
-        case 0x0015: // [FX15] sets the delay timer to VX
-            delay_timer = V[(opcode & 0x0F00) >> 8];
-            programCount += 2;
-            break;
+void chip8::op8XY0(const instruction& in) // [8XY0] sets VX to the value of VY
+{
+    V[in.x] = V[in.y];
+    programCount += 2;
+}
 
-        case 0x0018: // [FX18] sets the sound timer to VX
-            sound_timer = V[(opcode & 0x0F00) >> 8];
-            programCount += 2;
-            break;
+template<class Quirks>
+void chip8::op8XY1(const instruction& in) // [8XY1] sets VX to "VX OR VY"
+{
+    V[in.x] |= V[in.y];
+    if(Quirks::logicResetsVF) V[0xF] = 0;
+    programCount += 2;
+}
 
-        case 0x001E: // [FX1E] adds VX to indexReg
-            if(indexReg + V[(opcode & 0x0F00) >> 8] > 0xFFF){    // VF is set to 1 when range overflow (indexReg+VX>0xFFF), and 0 when there isn't.
-                V[0xF] = 1;
-            }
-            else{
-                V[0xF] = 0;
-            }
-            indexReg += V[(opcode & 0x0F00) >> 8];
-            programCount += 2;
-            break;
-
-        case 0x0029: // [FX29] sets indexReg to the location of the sprite for the character in VX. Characters 0-F (in hexadecimal) are represented by a 4x5 font
-            indexReg = V[(opcode & 0x0F00) >> 8] * 0x5;
-            programCount += 2;
-            break;
-
-        case 0x0033: // [FX33] stores the Binary-coded decimal representation of VX at the addresses indexReg, indexReg plus 1, and indexReg plus 2
-            memory[indexReg]     = V[(opcode & 0x0F00) >> 8] / 100;
-            memory[indexReg + 1] = (V[(opcode & 0x0F00) >> 8] / 10) % 10;
-            memory[indexReg + 2] = (V[(opcode & 0x0F00) >> 8] % 100) % 10;
-            programCount += 2;
-            break;
-
-        case 0x0055: // [FX55] stores V0 to VX in memory starting at address indexReg
-            for (int i = 0; i <= ((opcode & 0x0F00) >> 8); ++i){
-                memory[indexReg + i] = V[i];
-            }
+template<class Quirks>
+void chip8::op8XY2(const instruction& in) // [8XY2] sets VX to "VX AND VY"
+{
+    V[in.x] &= V[in.y];
+    if(Quirks::logicResetsVF) V[0xF] = 0;
+    programCount += 2;
+}
 
-            // on the original interpreter, when the operation is done, indexReg = indexReg + X + 1.
-            indexReg += ((opcode & 0x0F00) >> 8) + 1;
-            programCount += 2;
-            break;
+template<class Quirks>
+void chip8::op8XY3(const instruction& in) // [8XY3] sets VX to "VX XOR VY"
+{
+    V[in.x] ^= V[in.y];
+    if(Quirks::logicResetsVF) V[0xF] = 0;
+    programCount += 2;
+}
 
-        case 0x0065: // [FX65] Fills V0 to VX with values from memory starting at address indexReg
-            for (int i = 0; i <= ((opcode & 0x0F00) >> 8); ++i){
-                V[i] = memory[indexReg + i];
-            }
+void chip8::op8XY4(const instruction& in) // [8XY4] adds VY to VX. VF is set to 1 for carry, else 0
+{
+    V[0xF] = (V[in.y] > (0xFF - V[in.x])) ? 1 : 0;
+    V[in.x] += V[in.y];
+    programCount += 2;
+}
+
+void chip8::op8XY5(const instruction& in) // [8XY5] VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there isn't
+{
+    V[0xF] = (V[in.y] > V[in.x]) ? 0 : 1;
+    V[in.x] -= V[in.y];
+    programCount += 2;
+}
+
+template<class Quirks>
+void chip8::op8XY6(const instruction& in) // [8XY6] shifts VX (VY with shiftVY) right by one into VX. VF is set to the bit shifted out
+{
+    if(Quirks::shiftVY) {
+        unsigned char value = V[in.y];
+        V[in.x] = value >> 1;
+        V[0xF] = value & 0x1;
+    }
+    else {
+        V[0xF] = V[in.x] & 0x1;
+        V[in.x] >>= 1;
+    }
+    programCount += 2;
+}
+
+void chip8::op8XY7(const instruction& in) // [8XY7] sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there isn't
+{
+    V[0xF] = (V[in.x] > V[in.y]) ? 0 : 1;
+    V[in.x] = V[in.y] - V[in.x];
+    programCount += 2;
+}
+
+template<class Quirks>
+void chip8::op8XYE(const instruction& in) // [8XYE] shifts VX (VY with shiftVY) left by one into VX. VF is set to the bit shifted out
+{
+    if(Quirks::shiftVY) {
+        unsigned char value = V[in.y];
+        V[in.x] = value << 1;
+        V[0xF] = value >> 7;
+    }
+    else {
+        V[0xF] = V[in.x] >> 7;
+        V[in.x] <<= 1;
+    }
+    programCount += 2;
+}
+
+void chip8::op9XY0(const instruction& in) // [9XY0] skips the next instruction if VX doesn't equal VY
+{
+    programCount += (V[in.x] != V[in.y]) ? 4 : 2;
+}
 
-            // on the original interpreter, when the operation is done, indexReg = indexReg + X + 1.
-            indexReg += ((opcode & 0x0F00) >> 8) + 1;
-            programCount += 2;
-            break;
+void chip8::opANNN(const instruction& in) // [Axxx] sets indexReg to the address xxx
+{
+    indexReg = in.nnn;
+    programCount += 2;
+}
+
+template<class Quirks>
+void chip8::opBNNN(const instruction& in) // [Bxxx] jumps to the address xxx plus V0 (plus VX with jumpVX)
+{
+    programCount = in.nnn + V[Quirks::jumpVX ? in.x : 0];
+}
+
+void chip8::opCXNN(const instruction& in) // CXxx: Sets VX to a random number and xx
+{
+    V[in.x] = nextRandom(rngState) & in.nn;
+    programCount += 2;
+}
+
+template<class Quirks>
+void chip8::opDXYN(const instruction& in) // draws sprite at corrdinate (VX, VY) that has width of 8 pixels and height
+{                                         // of n pixels, wrapping around the screen edges (clipped with clipSprites).
+    unsigned int x = V[in.x] & 63;
+    unsigned int y = V[in.y] & 31;
+    unsigned int height = in.nn & 0x000F;
+    uint64_t collision = 0;
+
+    if(Quirks::clipSprites && y + height > 32) height = 32 - y;
+    for(unsigned int yline = 0; yline < height; yline++) {
+        unsigned char bits = memory[(indexReg + yline) & 0xFFF];
+        uint64_t sprite = Quirks::clipSprites ? (static_cast<uint64_t>(bits) << 56) >> x : spriteRow(bits, x);
+        uint64_t& row = display[(y + yline) & 31];
+        collision |= row & sprite;
+        row ^= sprite;
+        touchedRows |= 1u << ((y + yline) & 31);
+        staleRows |= 1u << ((y + yline) & 31);
+    }
+
+    V[0xF] = (collision != 0) ? 1 : 0;
+#if CHIP8_PROFILE
+    ++profile.draws;
+    profile.collisions += V[0xF];
+#endif
+    programCount += 2;
+}
 
-        default:
-            printf ("Unknown opcode [F000]: 0x%X\n", opcode);
+void chip8::opEX9E(const instruction& in) // EX9E: Skips the next instruction if the key stored in VX is pressed
+{
+    programCount += (keypad[V[in.x] & 0xF] != 0) ? 4 : 2;
+}
+
+void chip8::opEXA1(const instruction& in) // EXA1: Skips the next instruction if the key stored in VX isn't pressed
+{
+    programCount += (keypad[V[in.x] & 0xF] == 0) ? 4 : 2;
+}
+
+void chip8::opFX07(const instruction& in) // [FX07] sets VX to the value of the delay timer
+{
+    V[in.x] = delay_timer;
+    programCount += 2;
+#if CHIP8_PROFILE
+    ++profile.timerReads;
+#endif
+}
+
+void chip8::opFX0A(const instruction& in) // [FX0A] a key press is awaited, and then stored in VX
+{
+    bool keyPress = false;
+    for(int i = 0; i < 16; ++i) {
+        if(keypad[i] != 0) {
+            V[in.x] = i;
+            keyPress = true;
         }
-        break;
+    }
 
-    default:
-        printf("Unknown opcode: %X\n", opcode);
+    // no keyPress, skip cycle
+    if(!keyPress) {
+#if CHIP8_PROFILE
+        ++profile.keyWaits;
+#endif
+        return;
     }
+
+    programCount += 2;
+}
+
+void chip8::opFX15(const instruction& in) // [FX15] sets the delay timer to VX
+{
+    delay_timer = V[in.x];
+    programCount += 2;
+}
+
+void chip8::opFX18(const instruction& in) // [FX18] sets the sound timer to VX
+{
+    sound_timer = V[in.x];
+    programCount += 2;
+}
+
+void chip8::opFX1E(const instruction& in) // [FX1E] adds VX to indexReg
+{
+    // VF is set to 1 when range overflow (indexReg+VX>0xFFF), and 0 when there isn't.
+    V[0xF] = (indexReg + V[in.x] > 0xFFF) ? 1 : 0;
+    indexReg += V[in.x];
+    programCount += 2;
 }
 
+void chip8::opFX29(const instruction& in) // [FX29] sets indexReg to the location of the sprite for the character in VX. Characters 0-F (in hexadecimal) are represented by a 4x5 font
+{
+    indexReg = V[in.x] * 0x5;
+    programCount += 2;
+}
+
+void chip8::opFX33(const instruction& in) // [FX33] stores the Binary-coded decimal representation of VX at the addresses indexReg, indexReg plus 1, and indexReg plus 2
+{
+    unsigned char vx = V[in.x];
+    unsigned char digits[3] = { static_cast<unsigned char>(vx / 100), static_cast<unsigned char>((vx / 10) % 10),
+                                static_cast<unsigned char>((vx % 100) % 10) };
+    unshare();
+    for(int i = 0; i < 3; ++i) {
+        unsigned char& byte = memory[(indexReg + i) & 0xFFF];
+        if(byte == digits[i]) continue;
+        memoryHash ^= memoryKey(indexReg + i, byte) ^ memoryKey(indexReg + i, digits[i]);
+        byte = digits[i];
+    }
+    invalidate(indexReg, 3);
+    programCount += 2;
+}
+
+template<class Quirks>
+void chip8::opFX55(const instruction& in) // [FX55] stores V0 to VX in memory starting at address indexReg
+{
+    unshare();
+    for (int i = 0; i <= in.x; ++i){
+        unsigned char& byte = memory[(indexReg + i) & 0xFFF];
+        if(byte == V[i]) continue;
+        memoryHash ^= memoryKey(indexReg + i, byte) ^ memoryKey(indexReg + i, V[i]);
+        byte = V[i];
+    }
+    invalidate(indexReg, in.x + 1);
+
+    // on the original interpreter, when the operation is done, indexReg = indexReg + X + 1.
+    if(Quirks::indexAdvances) indexReg += in.x + 1;
+    programCount += 2;
+}
+
+template<class Quirks>
+void chip8::opFX65(const instruction& in) // [FX65] Fills V0 to VX with values from memory starting at address indexReg
+{
+    for (int i = 0; i <= in.x; ++i){
+        V[i] = memory[(indexReg + i) & 0xFFF];
+    }
+
+    // on the original interpreter, when the operation is done, indexReg = indexReg + X + 1.
+    if(Quirks::indexAdvances) indexReg += in.x + 1;
+    programCount += 2;
+}
+
+void chip8::opUnknown(const instruction& in) // stalls; programCount is not advanced
+{
+    faulted = true;
+}
+
+void chip8::opDebug(const instruction& in) // a breakpoint or watched memory access; the debugger may stop first
+{
+    instruction original = predecode(in.opcode);
+    if(debugger && debugger->stopsAt(original)) return;
+    execute(original);
+}
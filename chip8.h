@@ -6,44 +6,371 @@
 #define CHIP8_CHIP8_H
 
 #include <string>
-#include <fstream>
 #include <vector>
+#include <memory>
+#include <cstdint>
+#include "chip8jit.h"
+#include "chip8aot.h"
+#include "chip8trace.h"
+#include "chip8profile.h"
+#include "chip8state.h"
+#include "chip8roms.h"
+#include "chip8quirks.h"
+
+class chip8debug;
+
+/* Handler indices for pre-decoded instructions, in the same order
+ * as chip8::dispatchTable. hDecode marks a cache entry not yet decoded,
+ * hDebug one a debugger wants to see before it runs (see chip8debug.h). */
+enum opHandler {
+    hDecode = 0,
+    h00E0, h00EE, h1NNN, h2NNN, h3XNN, h4XNN, h5XY0, h6XNN, h7XNN,
+    h8XY0, h8XY1, h8XY2, h8XY3, h8XY4, h8XY5, h8XY6, h8XY7, h8XYE,
+    h9XY0, hANNN, hBNNN, hCXNN, hDXYN, hEX9E, hEXA1,
+    hFX07, hFX0A, hFX15, hFX18, hFX1E, hFX29, hFX33, hFX55, hFX65,
+    hUnknown, hDebug
+};
+
+/* An 8-pixel sprite row placed at column x of a display row,
+ * wrapping around the right edge */
+inline uint64_t spriteRow(unsigned char bits, unsigned int x)
+{
+    uint64_t row = static_cast<uint64_t>(bits) << 56;
+    return x ? (row >> x) | (row << (64 - x)) : row;
+}
+
+/* CXNN's random source: xorshift64*, one generator per instance so
+ * runs are reproducible and instances never contend for a shared one.
+ * seedRandom spreads a seed with splitmix64; the state is never 0. */
+inline uint64_t seedRandom(uint64_t seed)
+{
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+inline unsigned char nextRandom(uint64_t& state)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return static_cast<unsigned char>((state * 0x2545F4914F6CDD1DULL) >> 56);
+}
+
+/* Zobrist keys for the state hash (see chip8::stateHash). A memory
+ * byte is keyed by its address and value, mixed with splitmix64 rather
+ * than looked up, since stores are rare; a zero byte's key is 0, so
+ * cleared memory contributes nothing. memoryKeys is the XOR of the keys
+ * of a block of bytes placed at addr. */
+inline uint64_t memoryKey(unsigned short addr, unsigned char value)
+{
+    return value ? seedRandom(static_cast<uint64_t>(addr & 0xFFF) << 8 | value) : 0;
+}
+
+inline uint64_t memoryKeys(const unsigned char* bytes, size_t size, unsigned short addr)
+{
+    uint64_t keys = 0;
+    for(size_t i = 0; i < size; ++i) keys ^= memoryKey(addr + i, bytes[i]);
+    return keys;
+}
+
+/* FNV-1a over a block of bytes; identifies ROM images */
+inline uint64_t contentHash(const unsigned char* bytes, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* A pre-decoded instruction. The first time an address is executed
+ * its opcode is split into operands and mapped to a handler; after
+ * that, emulateCycle dispatches straight from the cached record. */
+struct instruction {
+    unsigned char handler;      // index into the dispatch table, 0 = not yet decoded
+    unsigned char x;            // 0X00
+    unsigned char y;            // 00Y0
+    unsigned char nn;           // 00NN (N is the low nibble)
+    unsigned short nnn;         // 0NNN
+    unsigned short opcode;      // raw opcode, kept for diagnostics
+};
+
+/* Memory together with the instructions decoded from it. Forks share
+ * one block until either side writes to memory; a block is only ever
+ * shared once every entry of its cache is decoded, so instances reading
+ * it never write to it. */
+struct chip8memory {
+    unsigned char bytes[4096];
+    instruction cache[4096];
+    bool complete;              // no cache entry is hDecode
+};
 
 class chip8 {
 public:
-    chip8(){}
+    chip8();
     ~chip8(){}
 
+    /* Loading resets the machine and copies the ROM to 0x200. All
+     * three fail on an empty or oversized ROM, loadGame also when the
+     * file can't be read, with the reason printed to stderr. */
     bool loadGame(std::string);
+    bool loadProgram(const unsigned char*, size_t);     // a ROM image already in memory
+    bool loadImage(const romImage&);                    // a mapped image from chip8roms
     void emulateCycle();
+    void runCycles(unsigned long);
+    void runFrame();
+    void enableJit(bool);
+    void enableAot(const chip8aot::program*);     // null disables; see chip8aot.h
+
+    /* Idle loops (on by default): a jump to itself, FX0A with no key
+     * down, a key-polling loop (EX9E or EXA1 jumping back to itself)
+     * whose key can't change within runCycles, and a delay-timer poll
+     * (FX07, 3XNN or 4XNN on the same VX, jump back) are run out in one
+     * step, up to the next timer tick that could end them. The resulting
+     * state is the same as executing every iteration. */
+    void enableIdleSkip(bool enable) { idleSkip = enable; }
+
+    /* Interpreter variant (see chip8quirks.h), chip8 by default. It is
+     * kept across loads and carried in save states and forks. Other
+     * variants always run interpreted, since JIT and AOT code implement
+     * chip8's quirks only. */
+    void setVariant(chip8variant);
+    chip8variant getVariant() const { return variant; }
+
+    /* How many more cycles the instance will spend in one of those
+     * loops if the keypad doesn't change: idleForever when only a key
+     * (or nothing) can end the wait, 0 when it isn't waiting. */
+    static const unsigned long idleForever = ~0UL;
+    unsigned long idleCycles() const;
+
+    /* Timing: the timers tick once every cyclesPerFrame instructions,
+     * so a frame of instructions is one 60 Hz period of game time no
+     * matter how fast the host runs them. chip8clock paces frames
+     * against the wall clock. */
+    static const unsigned int defaultCyclesPerFrame = 10;
+    void setCyclesPerFrame(unsigned int);
+    unsigned int getCyclesPerFrame() const { return cyclesPerFrame; }
     void decode(unsigned short);
     void setKeypad();
 
-    bool drawFlag;
+    /* Seed for CXNN. Every load restarts the sequence from the seed, so
+     * a ROM run with the same seed and input behaves the same each time.
+     * The generator's current state is part of save states and forks. */
+    void seed(uint64_t);
+    uint64_t getSeed() const { return rngSeed; }
+
+    /* read-only view of the machine state for headless hosts */
+    const unsigned char* getRegisters() const { return V; }
+    unsigned short getIndexReg() const { return indexReg; }
+    unsigned short getProgramCount() const { return programCount; }
+    unsigned char peek(unsigned short addr) const { return memory[addr & 0xFFF]; }
+    unsigned long long frameHash() const;
+
+    /* Hash of everything that decides how the machine runs on: memory,
+     * display, V, I, PC, the live part of the stack, timers, the frame
+     * phase, the CXNN generator, the variant and the fault flag, but not
+     * the keypad or the cycle count. Memory is a Zobrist hash kept up to
+     * date by the stores that change it; the display is hashed per row,
+     * and a sprite only marks its rows for rehashing on the next read.
+     * The registers, some 60 bytes, are folded in here, each word with a
+     * full splitmix64 round. Reading it costs at most 32 row hashes and
+     * typically a few, never a scan of memory.
+     * Equal states have equal hashes; different states collide with
+     * probability about 2^-64. */
+    uint64_t stateHash() const;
+
+    /* instructions run since the ROM was loaded, and the contentHash
+     * of the loaded ROM image */
+    unsigned long long getCycleCount() const { return cycleCount; }
+    uint64_t getRomHash() const { return romHash; }
+
+    /* the sound timer is running; frontends play a tone while true */
+    bool isBeeping() const { return sound_timer > 0; }
+    unsigned char getDelayTimer() const { return delay_timer; }
+    unsigned char getSoundTimer() const { return sound_timer; }
+
+    /* Save states (see chip8state.h). Loading rejects records from
+     * other versions or with a stack pointer past 16, keeps decoded
+     * instructions and compiled blocks for memory that did not change,
+     * and marks every row damaged. */
+    void saveState(chip8state&) const;
+    bool loadState(const chip8state&);
+    bool saveState(const std::string&) const;
+    bool loadState(const std::string&);
+
+    /* Forking for search: the child takes over this instance's state,
+     * variant and idle-loop skipping, and shares its memory copy-on-
+     * write, so a fork copies well under 1 KB. The first store to
+     * memory on either side then copies the memory and its decoded
+     * instructions, about 36 KB. Children run interpreted; neither the
+     * JIT nor trace or profile data are inherited. forkAndRun forks one
+     * child per entry of keys (bit k = key k held) and runs each for
+     * the given cycles, reusing the children from earlier calls. */
+    void fork(chip8&);
+    void forkAndRun(std::vector<std::unique_ptr<chip8>>&, const uint16_t*, size_t, unsigned long);
+
+    /* an unknown opcode, a return with an empty stack or a call with
+     * all 16 levels in use was hit; the machine stalls on it */
+    bool hasFaulted() const { return faulted; }
+
+    /* write the trace ring buffer (see chip8trace.h); false when
+     * tracing is compiled out or the file can't be written */
+    bool dumpTrace(const std::string&) const;
+
+    /* write the profile (see chip8profile.h) as JSON when the path
+     * ends in .json, CSV otherwise; false when profiling is compiled
+     * out or the file can't be written */
+    bool writeProfile(const std::string&) const;
 
     /* The graphics system: The chip 8 has one instruction that
      * draws sprite to the screen. Drawing is done in XOR mode
      * and if a pixel is turned off as a result of drawing, the
      * VF register is set. This is used for collision detection.
      * The graphics of the Chip 8 are black and white and the screen
-     * has a total of 2048 pixels (64 x 32). This can easily be
-     * implemented using an array that hold the pixel state (1 or 0) */
-    unsigned char gfx[64 * 32];
+     * has a total of 2048 pixels (64 x 32). Each row is stored as
+     * one 64-bit word, pixel x at bit (63 - x), so a sprite row is
+     * drawn with a single shift, AND and XOR */
+    const uint64_t* getDisplay() const { return display; }
+    unsigned char getPixel(int x, int y) const { return (display[y] >> (63 - x)) & 1; }
+    void getGfx(unsigned char*) const;     // unpack to 64 * 32 bytes, one per pixel
+
+    /* Damage tracking: rows whose pixels differ from what the frontend
+     * last acknowledged, as a bitmask (bit n = row n). Drawing a sprite
+     * and erasing it again before the next acknowledgement reports no
+     * damage. Other consumers can diff against their own copy of the
+     * rows with changedRows. */
+    uint32_t damagedRows() const;
+    void acknowledgeDamage();
+    uint32_t changedRows(const uint64_t*) const;
+    static bool rowSpan(uint32_t, int&, int&);  // first and last row in a mask
 
     /* Chip 8 has hexadecimal-based keypad (0x0-0xf)
      * array keypad[16] to store current state */
     unsigned char keypad[16];
 
 private:
+    friend class chip8jit;
+    friend class chip8aot;
+    friend class chip8wide;
+    friend class chip8debug;
+
     void initialize();
+    void advanceClock(unsigned long);
+    void updateTimers();
+
+    /* decoding and dispatch */
+    void step();
+    instruction& fetch();
+    instruction& decodedAt(unsigned short);
+    unsigned long skipIdle(unsigned long);
+    static instruction predecode(unsigned short);
+    void execute(const instruction&);
+    void invalidate(unsigned short, unsigned short);
+    void unshare();
+    void remark();
+    void debugCycles(unsigned long);
+
+    /* one handler per opcode, indexed by instruction::handler; one
+     * table per quirk policy, handlers points at the variant's */
+    typedef void (chip8::*handlerFn)(const instruction&);
+    template<class Quirks> struct dispatchTable {
+        static const handlerFn handlers[];
+    };
+
+    void op00E0(const instruction&);
+    void op00EE(const instruction&);
+    void op1NNN(const instruction&);
+    void op2NNN(const instruction&);
+    void op3XNN(const instruction&);
+    void op4XNN(const instruction&);
+    void op5XY0(const instruction&);
+    void op6XNN(const instruction&);
+    void op7XNN(const instruction&);
+    void op8XY0(const instruction&);
+    template<class Quirks> void op8XY1(const instruction&);
+    template<class Quirks> void op8XY2(const instruction&);
+    template<class Quirks> void op8XY3(const instruction&);
+    void op8XY4(const instruction&);
+    void op8XY5(const instruction&);
+    template<class Quirks> void op8XY6(const instruction&);
+    void op8XY7(const instruction&);
+    template<class Quirks> void op8XYE(const instruction&);
+    void op9XY0(const instruction&);
+    void opANNN(const instruction&);
+    template<class Quirks> void opBNNN(const instruction&);
+    void opCXNN(const instruction&);
+    template<class Quirks> void opDXYN(const instruction&);
+    void opEX9E(const instruction&);
+    void opEXA1(const instruction&);
+    void opFX07(const instruction&);
+    void opFX0A(const instruction&);
+    void opFX15(const instruction&);
+    void opFX18(const instruction&);
+    void opFX1E(const instruction&);
+    void opFX29(const instruction&);
+    void opFX33(const instruction&);
+    template<class Quirks> void opFX55(const instruction&);
+    template<class Quirks> void opFX65(const instruction&);
+    void opUnknown(const instruction&);
+    void opDebug(const instruction&);
+
     /* 35 opcodes */
     unsigned short opcode;
 
+    /* 64 x 32 display, one word per row */
+    uint64_t display[32];
+
+    /* State hash parts: a Zobrist hash of memory, updated by every
+     * store, and a hash per display row, combined in displayHash.
+     * Drawing only marks rows stale; stateHash rehashes those */
+    uint64_t memoryHash = 0;
+    mutable uint64_t rowHashes[32];
+    mutable uint64_t displayHash;
+    mutable uint32_t staleRows;
+
+    /* rows as last acknowledged, and rows drawn to since then */
+    uint64_t presented[32];
+    uint32_t touchedRows;
+
     /* 4K memory */
     /* 0x000-0x1FF - Chip 8 interpreter (contains font set in emu)
      * 0x050-0x0A0 - Used for the built in 4x5 pixel font set (0-F)
-     * 0x200-0xFFF - Program ROM and work RAM */
-    unsigned char memory[4096];
+     * 0x200-0xFFF - Program ROM and work RAM
+     * memory and cache point into ram, which may be shared with forks;
+     * call unshare() before writing either */
+    std::shared_ptr<chip8memory> ram;
+    unsigned char* memory;
+
+    /* decoded instruction for every address in memory. Entries are
+     * reset whenever the bytes they were decoded from are written */
+    instruction* cache;
+
+    /* optional native code for hot blocks, null when disabled */
+    std::unique_ptr<chip8jit> jit;
+
+    /* optional ahead-of-time translation of the loaded ROM */
+    std::unique_ptr<chip8aot> aot;
+
+    /* attached debugger, null when there is none */
+    chip8debug* debugger = nullptr;
+
+    bool faulted;
+    bool idleSkip = true;
+
+    /* interpreter variant and its dispatch table */
+    chip8variant variant = variantChip8;
+    const handlerFn* handlers = dispatchTable<chip8Quirks>::handlers;
+
+#if CHIP8_TRACE_LEVEL > 0
+    chip8trace trace;
+#endif
+
+#if CHIP8_PROFILE
+    chip8profile profile;
+#endif
 
     /* 15 8-bit general purpose registers V0 -> VE
      * . VF (register 16) is reserved for a "carry
@@ -61,6 +388,17 @@ private:
     unsigned char delay_timer;
     unsigned char sound_timer;
 
+    /* instructions per 60 Hz frame, and instructions run in this frame */
+    unsigned int cyclesPerFrame = defaultCyclesPerFrame;
+    unsigned int frameCycle;
+    unsigned long long cycleCount = 0;
+
+    uint64_t romHash = 0;
+
+    /* CXNN generator: the seed set by seed(), and the current state */
+    uint64_t rngSeed = 0;
+    uint64_t rngState = seedRandom(0);
+
     /* stack pointer has 16 levels, stack pointer sp for remembering
      * which level of stack used */
     unsigned short stack[16];
@@ -68,25 +406,7 @@ private:
 
     /* This is the Chip 8 font set. Each number or
      * character is 4 pixels wide and 5 pixel high */
-    unsigned char chip8_fontset[80] =
-            {
-                    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-                    0x20, 0x60, 0x20, 0x20, 0x70, // 1
-                    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-                    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-                    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-                    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-                    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-                    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-                    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-                    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-                    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-                    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-                    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-                    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-                    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-                    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-            };
+    static const unsigned char chip8_fontset[80];
 };
 
 #endif //CHIP8_CHIP8_H
@@ -0,0 +1,65 @@
+#include "chip8aot.h"
+#include "chip8.h"
+
+chip8aot::chip8aot(const program& p)
+        : translated(p)
+{
+    reset();
+}
+
+void chip8aot::reset()
+{
+    for(int i = 0; i < 4096; ++i) entry[i] = nullptr;
+    for(size_t b = 0; b < translated.count; ++b) {
+        entry[translated.blocks[b].addr & 0xFFF] = &translated.blocks[b];
+    }
+}
+
+void chip8aot::invalidate(unsigned short addr, unsigned short len)
+{
+    for(size_t b = 0; b < translated.count; ++b) {
+        const block& blk = translated.blocks[b];
+        if(addr < blk.end && addr + len > blk.addr) {
+            entry[blk.addr & 0xFFF] = nullptr;
+            m.stale = true;
+        }
+    }
+}
+
+unsigned long chip8aot::execute(chip8& c8, unsigned long budget)
+{
+    if(c8.programCount > 0xFFF || c8.romHash != translated.romHash) return 0;
+
+    const block* b = entry[c8.programCount];
+    if(!b || b->length > budget) return 0;
+
+    m.V = c8.V;
+    m.I = &c8.indexReg;
+    m.pc = &c8.programCount;
+    m.stale = false;
+    m.c8 = &c8;
+    m.synced = 0;
+
+    unsigned long ran = b->run(m);
+    c8.advanceClock(ran - m.synced);
+    return ran;
+}
+
+instruction chip8aot::decode(unsigned short op)
+{
+    return chip8::predecode(op);
+}
+
+void chip8aot::machine::step(unsigned short addr)
+{
+    c8->programCount = addr;
+    const instruction& in = c8->fetch();
+    c8->opcode = in.opcode;
+    c8->execute(in);
+}
+
+void chip8aot::machine::sync(unsigned long n)
+{
+    c8->advanceClock(n - synced);
+    synced = n;
+}
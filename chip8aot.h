@@ -0,0 +1,88 @@
+//
+// Ahead-of-time translated ROMs for the chip8 core.
+//
+
+#ifndef CHIP8_CHIP8AOT_H
+#define CHIP8_CHIP8AOT_H
+
+#include <cstdint>
+#include <cstddef>
+
+class chip8;
+struct instruction;
+
+/* c8aot translates a ROM's reachable basic blocks into C++ functions
+ * (see c8aot.cpp). Linked into a host and enabled with
+ * chip8::enableAot, those functions run instead of the interpreter
+ * whenever programCount lands on a block start, as long as the loaded
+ * ROM has the hash the program was translated from.
+ *
+ * Register arithmetic, jumps and skips are emitted as plain C++; the
+ * remaining instructions call back into the interpreter's handlers.
+ * BNNN, FX0A and anything not found statically (computed targets,
+ * code written at runtime) run interpreted. A store into translated
+ * code disables the blocks it overlaps and ends the running block. */
+class chip8aot {
+public:
+    /* the machine as generated code sees it */
+    struct machine {
+        unsigned char* V;
+        unsigned short* I;
+        unsigned short* pc;
+        bool stale;                 // the running block's code was overwritten
+
+        /* run the instruction at addr through the interpreter */
+        void step(unsigned short);
+
+        /* clock the first n instructions of the block, before one
+         * that reads or sets a timer */
+        void sync(unsigned long);
+
+        chip8* c8;
+        unsigned long synced;
+    };
+
+    /* a block runs `length` instructions (fewer only when it turns
+     * stale), leaves programCount at the next address and returns the
+     * number of instructions run */
+    typedef unsigned long (*blockFn)(machine&);
+
+    struct block {
+        unsigned short addr;        // first byte
+        unsigned short end;         // one past the last byte
+        unsigned short length;      // instructions
+        blockFn run;
+    };
+
+    struct program {
+        uint64_t romHash;
+        const block* blocks;
+        size_t count;
+    };
+
+    explicit chip8aot(const program&);
+
+    /* run the block at the current programCount if there is one and it
+     * fits in the cycle budget. Returns the number of instructions run,
+     * 0 if the interpreter has to run the next instruction instead */
+    unsigned long execute(chip8&, unsigned long);
+
+    /* memory[addr, addr + len) was written */
+    void invalidate(unsigned short, unsigned short);
+
+    /* a ROM was (re)loaded: every block is valid again */
+    void reset();
+
+    /* the core's decoder, for the translator */
+    static instruction decode(unsigned short);
+
+private:
+    chip8aot(const chip8aot&);
+    chip8aot& operator=(const chip8aot&);
+
+    const program& translated;
+    const block* entry[4096];       // block starting at each address, if valid
+    machine m;
+};
+
+#endif //CHIP8_CHIP8AOT_H
@@ -0,0 +1,94 @@
+#include "chip8clock.h"
+#include <thread>
+using namespace std;
+
+static const chrono::nanoseconds framePeriod(1000000000 / chip8clock::framesPerSecond);
+
+chip8clock::chip8clock(chip8& c8, mode m)
+        : c8(c8), current(m), nextFrame(clock::now()), frames(0)
+{
+}
+
+void chip8clock::setMode(mode m)
+{
+    current = m;
+    nextFrame = clock::now();
+}
+
+void chip8clock::setSpeed(unsigned int instructionsPerSecond)
+{
+    c8.setCyclesPerFrame((instructionsPerSecond + framesPerSecond / 2) / framesPerSecond);
+}
+
+unsigned long chip8clock::runDue()
+{
+    unsigned long ran = 0;
+
+    switch(current) {
+    case realTime:
+    {
+        clock::time_point now = clock::now();
+        while(nextFrame <= now && ran < maxCatchUp) {
+            c8.runFrame();
+            nextFrame += framePeriod;
+            ++ran;
+        }
+
+        // too far behind (stalled window, debugger): drop the backlog
+        if(nextFrame <= now) nextFrame = now + framePeriod;
+    }
+        break;
+
+    case turbo:
+        for(; ran < turboBatch; ++ran) c8.runFrame();
+        break;
+
+    case fixedStep:
+        c8.runFrame();
+        ran = 1;
+        break;
+    }
+
+    frames += ran;
+    return ran;
+}
+
+unsigned long chip8clock::skipDue()
+{
+    if(current != realTime) return 1;
+
+    unsigned long due = 0;
+    clock::time_point now = clock::now();
+    while(nextFrame <= now && due < maxCatchUp) {
+        nextFrame += framePeriod;
+        ++due;
+    }
+    if(nextFrame <= now) nextFrame = now + framePeriod;
+    return due;
+}
+
+void chip8clock::sleepUntilDue() const
+{
+    if(current == realTime) this_thread::sleep_until(nextFrame);
+}
+
+void chip8clock::run(unsigned long count)
+{
+    unsigned long long target = frames + count;
+    while(frames < target) {
+        if(current == realTime) {
+            sleepUntilDue();
+            unsigned long ran = 0;
+            while(frames < target && nextFrame <= clock::now() && ran < maxCatchUp) {
+                c8.runFrame();
+                nextFrame += framePeriod;
+                ++frames;
+                ++ran;
+            }
+        }
+        else {
+            c8.runFrame();
+            ++frames;
+        }
+    }
+}
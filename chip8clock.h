@@ -0,0 +1,62 @@
+//
+// Frame pacing for a chip8 instance.
+//
+
+#ifndef CHIP8_CHIP8CLOCK_H
+#define CHIP8_CHIP8CLOCK_H
+
+#include <chrono>
+#include "chip8.h"
+
+/* Runs a chip8 one 60 Hz frame at a time (cyclesPerFrame instructions,
+ * then a timer tick) in one of three modes:
+ *
+ *   realTime   frames are run as the wall clock makes them due, catching
+ *              up at most maxCatchUp frames after a stall
+ *   turbo      frames are run back to back in batches, as fast as the
+ *              host allows; game behaviour is unchanged since timers
+ *              still tick per frame, not per second
+ *   fixedStep  each call runs exactly one frame, for hosts that drive
+ *              emulation deterministically (replays, tests, training) */
+class chip8clock {
+public:
+    enum mode { realTime, turbo, fixedStep };
+
+    chip8clock(chip8&, mode = realTime);
+
+    void setMode(mode);
+    mode getMode() const { return current; }
+
+    /* instructions per second; rounded to whole instructions per frame */
+    void setSpeed(unsigned int);
+
+    /* run every frame that is due now, returns the number of frames run */
+    unsigned long runDue();
+
+    /* consume the frames that are due without running them, for hosts
+     * that spend those frames on something else (rewinding); returns
+     * the number consumed */
+    unsigned long skipDue();
+
+    /* block until the next frame is due (real-time mode only) */
+    void sleepUntilDue() const;
+
+    /* run the given number of frames, paced according to the mode */
+    void run(unsigned long);
+
+    unsigned long long framesRun() const { return frames; }
+
+    static const unsigned int framesPerSecond = 60;
+    static const unsigned int maxCatchUp = 4;
+    static const unsigned int turboBatch = 64;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    chip8& c8;
+    mode current;
+    clock::time_point nextFrame;
+    unsigned long long frames;
+};
+
+#endif //CHIP8_CHIP8CLOCK_H
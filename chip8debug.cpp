@@ -0,0 +1,318 @@
+#include "chip8debug.h"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+using namespace std;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0      // macOS: SO_NOSIGPIPE is set per socket instead
+#endif
+
+static string hex(unsigned int value, int digits = 3)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "0x%0*x", digits, value);
+    return text;
+}
+
+static bool parseNumber(const string& text, int base, unsigned long& value)
+{
+    if(text.empty()) return false;
+    char* end;
+    value = strtoul(text.c_str(), &end, base);
+    return *end == '\0';
+}
+
+chip8debug::chip8debug(chip8& c8)
+        : c8(c8)
+{
+    c8.debugger = this;
+}
+
+chip8debug::~chip8debug()
+{
+    for(size_t i = 0; i < clients.size(); ++i) close(clients[i].fd);
+    if(server >= 0) close(server);
+
+    c8.debugger = nullptr;
+    c8.remark();
+}
+
+bool chip8debug::listen(unsigned short port)
+{
+    server = socket(AF_INET, SOCK_STREAM, 0);
+    if(server < 0) {
+        cerr << "Could not create the debugger socket" << endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(::bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(server, 4) < 0) {
+        cerr << "Could not listen on port " << port << ": " << strerror(errno) << endl;
+        close(server);
+        server = -1;
+        return false;
+    }
+    return true;
+}
+
+void chip8debug::poll(int timeout)
+{
+    if(server < 0) return;
+    if(announce) {
+        announce = false;
+        broadcast("stopped " + reason);
+    }
+
+    vector<pollfd> fds(1 + clients.size());
+    fds[0].fd = server;
+    fds[0].events = POLLIN;
+    for(size_t i = 0; i < clients.size(); ++i) {
+        fds[i + 1].fd = clients[i].fd;
+        fds[i + 1].events = POLLIN;
+    }
+    if(::poll(fds.data(), fds.size(), timeout) <= 0) return;
+
+    // clients first, from the back, so dropping one doesn't move the rest
+    for(size_t i = clients.size(); i-- > 0;) {
+        if(!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        char buffer[512];
+        ssize_t got = recv(clients[i].fd, buffer, sizeof(buffer), 0);
+        if(got <= 0) {
+            drop(i);
+            continue;
+        }
+
+        string& input = clients[i].input;
+        input.append(buffer, got);
+        size_t end;
+        while((end = input.find('\n')) != string::npos) {
+            string line = input.substr(0, end);
+            input.erase(0, end + 1);
+            if(!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+            if(line.empty()) continue;
+
+            string reply = command(line) + "\n";
+            send(clients[i].fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+        }
+        if(input.size() > 4096) drop(i);   // not a line protocol client
+    }
+
+    if(fds[0].revents & POLLIN) {
+        int fd = accept(server, nullptr, nullptr);
+        if(fd >= 0) {
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+            client c = { fd, string() };
+            clients.push_back(c);
+        }
+    }
+}
+
+void chip8debug::drop(size_t i)
+{
+    close(clients[i].fd);
+    clients.erase(clients.begin() + i);
+
+    // nobody is left to resume a paused instance
+    if(clients.empty() && stopped) command("continue");
+}
+
+void chip8debug::broadcast(const string& line)
+{
+    string text = line + "\n";
+    for(size_t i = 0; i < clients.size(); ++i) {
+        send(clients[i].fd, text.data(), text.size(), MSG_NOSIGNAL);
+    }
+}
+
+string chip8debug::command(const string& line)
+{
+    istringstream in(line);
+    string verb, a, b, c;
+    in >> verb >> a >> b >> c;
+    unsigned long addr = 0, n = 0;
+
+    if(verb == "break" || verb == "delete") {
+        if(!parseNumber(a, 16, addr) || addr > 0xFFF) return "error bad address";
+        if(verb == "delete" && !breakpoints[addr]) return "error no breakpoint at " + hex(addr);
+        breakpoints[addr] = verb == "break";
+        c8.remark();
+        return "ok";
+    }
+
+    if(verb == "watch") {
+        if(!parseNumber(a, 16, addr) || addr > 0xFFF) return "error bad address";
+        n = 1;
+        if(!b.empty() && !parseNumber(b, 10, n)) {
+            c = b;      // watch ADDR r|w|rw
+            n = 1;
+        }
+        if(n == 0 || n > 0x1000) return "error bad length";
+        if(c.empty()) c = "rw";
+        if(c != "r" && c != "w" && c != "rw") return "error access is r, w or rw";
+
+        watchpoint w = { static_cast<unsigned short>(addr), static_cast<unsigned short>(n),
+                         c.find('r') != string::npos, c.find('w') != string::npos };
+        watches.push_back(w);
+        c8.remark();
+        return "ok";
+    }
+
+    if(verb == "unwatch") {
+        if(!parseNumber(a, 16, addr)) return "error bad address";
+        for(size_t i = 0; i < watches.size(); ++i) {
+            if(watches[i].address == addr) {
+                watches.erase(watches.begin() + i);
+                c8.remark();
+                return "ok";
+            }
+        }
+        return "error no watchpoint at " + hex(addr);
+    }
+
+    if(verb == "list") {
+        string out = "breaks";
+        for(unsigned int i = 0; i < 4096; ++i) {
+            if(breakpoints[i]) out += " " + hex(i);
+        }
+        out += "; watches";
+        for(size_t i = 0; i < watches.size(); ++i) {
+            const watchpoint& w = watches[i];
+            out += " " + hex(w.address) + "+" + to_string(w.length) + " " + (w.reads ? "r" : "") + (w.writes ? "w" : "");
+        }
+        return out;
+    }
+
+    if(verb == "pause") {
+        return stop("pause");
+    }
+
+    if(verb == "continue") {
+        if(stopped) {
+            stopped = false;
+            passCycle = c8.cycleCount;
+        }
+        return "ok";
+    }
+
+    if(verb == "step") {
+        n = 1;
+        if(!a.empty() && (!parseNumber(a, 10, n) || n == 0)) return "error bad count";
+        if(!stopped) return "error not paused";
+        return step(n);
+    }
+
+    if(verb == "regs") {
+        char text[160];
+        snprintf(text, sizeof(text), "pc %s i %s sp %u dt %u st %u cycle %llu v",
+                 hex(c8.programCount).c_str(), hex(c8.indexReg).c_str(), c8.stackPointer,
+                 c8.delay_timer, c8.sound_timer, c8.cycleCount);
+        string out = text;
+        for(int i = 0; i < 16; ++i) {
+            snprintf(text, sizeof(text), " %02x", c8.V[i]);
+            out += text;
+        }
+        return out;
+    }
+
+    if(verb == "stack") {
+        string out = "stack";
+        for(unsigned int i = 0; i < c8.stackPointer && i < 16; ++i) out += " " + hex(c8.stack[i]);
+        return out;
+    }
+
+    if(verb == "mem") {
+        if(!parseNumber(a, 16, addr) || addr > 0xFFF) return "error bad address";
+        n = 16;
+        if(!b.empty() && (!parseNumber(b, 10, n) || n == 0 || n > 256)) return "error bad length";
+
+        string out = "mem " + hex(addr);
+        char text[4];
+        for(unsigned long i = 0; i < n; ++i) {
+            snprintf(text, sizeof(text), " %02x", c8.memory[(addr + i) & 0xFFF]);
+            out += text;
+        }
+        return out;
+    }
+
+    return "error unknown command " + verb;
+}
+
+// run n instructions from a pause; the first runs even if it is the one
+// that stopped the instance
+string chip8debug::step(unsigned long n)
+{
+    for(unsigned long i = 0; i < n; ++i) {
+        stopped = false;
+        passCycle = c8.cycleCount;
+        c8.debugCycles(1);
+        if(stopped) {
+            announce = false;   // this reply is the announcement
+            return "stopped " + reason;
+        }
+    }
+    return stop("step");
+}
+
+string chip8debug::stop(const string& why)
+{
+    stopped = true;
+    reason = why + " pc " + hex(c8.programCount & 0xFFF);
+    return "stopped " + reason;
+}
+
+bool chip8debug::stopsAt(const instruction& in)
+{
+    if(c8.cycleCount == passCycle) return false;
+
+    unsigned short pc = c8.programCount & 0xFFF;
+    if(breakpoints[pc]) {
+        stop("break");
+        announce = true;
+        return true;
+    }
+    if(watches.empty()) return false;
+
+    // the bytes the instruction reads or writes, from I
+    unsigned int length;
+    bool writes = false;
+    switch(in.handler) {
+    case hDXYN: length = in.nn & 0xF; break;
+    case hFX33: length = 3; writes = true; break;
+    case hFX55: length = in.x + 1; writes = true; break;
+    case hFX65: length = in.x + 1; break;
+    default:    return false;
+    }
+
+    for(unsigned int i = 0; i < length; ++i) {
+        unsigned short addr = (c8.indexReg + i) & 0xFFF;
+        for(size_t w = 0; w < watches.size(); ++w) {
+            const watchpoint& watch = watches[w];
+            if(!(writes ? watch.writes : watch.reads)) continue;
+            if(((addr - watch.address) & 0xFFF) >= watch.length) continue;     // wraps like memory
+
+            stop(string("watch ") + (writes ? "write " : "read ") + hex(addr));
+            announce = true;
+            return true;
+        }
+    }
+    return false;
+}
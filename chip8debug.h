@@ -0,0 +1,109 @@
+//
+// Debugger for a running chip8: breakpoints, memory watchpoints,
+// single-stepping and inspection over a local socket.
+//
+
+#ifndef CHIP8_CHIP8DEBUG_H
+#define CHIP8_CHIP8DEBUG_H
+
+#include <bitset>
+#include <string>
+#include <vector>
+#include "chip8.h"
+
+/* Attaches to one instance for its lifetime. Breakpoints and
+ * watchpoints are not checked per cycle: the decoded entry of a
+ * breakpoint address is marked with hDebug, and while any watchpoint is
+ * set so is every instruction that touches memory (DXYN, FX33, FX55,
+ * FX65). Only marked entries reach the debugger, which stops the
+ * instance before they execute, without using up their cycle. An
+ * instance with nothing set runs exactly as fast as one with no
+ * debugger; with anything set or while paused it runs interpreted.
+ *
+ * Line protocol, one command per line, addresses in hex:
+ *
+ *   break ADDR / delete ADDR    set or clear a breakpoint
+ *   watch ADDR [LEN] [r|w|rw]   stop on reads and/or writes of memory
+ *                               (rw by default); unwatch ADDR clears it
+ *   list                        breakpoints and watchpoints
+ *   pause / continue            stop or resume the instance
+ *   step [N]                    run N instructions (1), while paused
+ *   regs                        PC, I, SP, timers, cycle count, V0-VF
+ *   stack                       return addresses, innermost last
+ *   mem ADDR [LEN]              up to 256 bytes of memory (16)
+ *
+ * Every command gets one line back: "ok", "error <reason>", the data
+ * asked for, or for pause and step, "stopped <reason> pc ADDR". When a
+ * running instance hits a breakpoint or watchpoint, every client gets
+ * "stopped break pc ADDR" or "stopped watch <read|write> ADDR pc ADDR"
+ * from the next poll().
+ *
+ * The host owns the pacing: it calls poll() between runs on the thread
+ * that runs the instance, and doesn't run it while paused() (a stop in
+ * the middle of runCycles returns early, leaving the instance on the
+ * instruction that stopped it). When the last client disconnects, a
+ * paused instance resumes. The debugger must not outlive the instance. */
+class chip8debug {
+public:
+    explicit chip8debug(chip8&);
+    ~chip8debug();
+
+    /* listen on 127.0.0.1; false (with a message on stderr) when the
+     * port can't be bound */
+    bool listen(unsigned short port);
+
+    /* accept clients and run the commands they sent, waiting up to
+     * timeout milliseconds for one (-1 waits indefinitely) */
+    void poll(int timeout = 0);
+
+    /* run one protocol command and return the reply, without the newline */
+    std::string command(const std::string&);
+
+    bool paused() const { return stopped; }
+
+private:
+    friend class chip8;
+
+    struct watchpoint {
+        unsigned short address;
+        unsigned short length;
+        bool reads;
+        bool writes;
+    };
+
+    /* called by chip8: whether a freshly decoded entry is marked, and
+     * whether the marked instruction about to run stops the instance */
+    bool marks(unsigned short addr, unsigned char handler) const
+    {
+        return breakpoints[addr & 0xFFF] || (!watches.empty() && accessesMemory(handler));
+    }
+    bool stopsAt(const instruction&);
+    bool active() const { return stopped || breakpoints.any() || !watches.empty(); }
+
+    static bool accessesMemory(unsigned char handler)
+    {
+        return handler == hDXYN || handler == hFX33 || handler == hFX55 || handler == hFX65;
+    }
+
+    std::string stop(const std::string& reason);
+    std::string step(unsigned long);
+    void broadcast(const std::string&);
+    void drop(size_t);
+
+    chip8& c8;
+    std::bitset<4096> breakpoints;
+    std::vector<watchpoint> watches;
+    bool stopped = false;
+    bool announce = false;              // a stop during a run that clients haven't been told of
+    std::string reason;                 // why and where the instance last stopped
+    unsigned long long passCycle = ~0ULL;  // the cycle resumed at, which runs without stopping
+
+    int server = -1;
+    struct client {
+        int fd;
+        std::string input;
+    };
+    std::vector<client> clients;
+};
+
+#endif //CHIP8_CHIP8DEBUG_H
@@ -0,0 +1,128 @@
+#include "chip8env.h"
+#include <cstring>
+using namespace std;
+
+chip8env::chip8env(size_t count, observation format, uint64_t seed)
+        : count(count ? count : 1), format(format), seed(seed)
+{
+    // trace and profile builds make instances large, keep them on the heap
+    for(size_t i = 0; i < this->count; ++i) instances.emplace_back(new chip8());
+}
+
+bool chip8env::load(const romImage& image, chip8variant variant)
+{
+    chip8& first = *instances[0];
+    first.setVariant(variant);
+    if(!first.loadImage(image)) return false;
+    first.saveState(initial);
+
+    obs.assign(count * observationSize(), 0);
+    reward.assign(count, 0);
+    done.assign(count, 0);
+    episodes.assign(count, 0);
+    last.assign(count * rules.size(), 0);
+    start.assign(count * rules.size(), 0);
+
+    reset();
+    return true;
+}
+
+void chip8env::addRule(const watchRule& rule)
+{
+    rules.push_back(rule);
+    if(obs.empty()) return;     // load() lays the per-rule values out
+
+    // re-lay the per-rule values out, taking the new rule's from now
+    vector<uint8_t> wasLast(last), wasStart(start);
+    size_t n = rules.size();
+    last.assign(count * n, 0);
+    start.assign(count * n, 0);
+    for(size_t i = 0; i < count; ++i) {
+        for(size_t r = 0; r + 1 < n; ++r) {
+            last[i * n + r] = wasLast[i * (n - 1) + r];
+            start[i * n + r] = wasStart[i * (n - 1) + r];
+        }
+        last[i * n + n - 1] = start[i * n + n - 1] = watched(i, rule.address);
+    }
+}
+
+void chip8env::reset()
+{
+    for(size_t i = 0; i < count; ++i) {
+        startEpisode(i);
+        reward[i] = 0;
+        done[i] = 0;
+        observe(i);
+    }
+}
+
+void chip8env::step(const uint16_t* actions, unsigned int frames)
+{
+    size_t n = rules.size();
+
+    for(size_t i = 0; i < count; ++i) {
+        chip8& c8 = *instances[i];
+        if(done[i]) startEpisode(i);
+
+        for(int k = 0; k < 16; ++k) c8.keypad[k] = (actions[i] >> k) & 1;
+        c8.runCycles(static_cast<unsigned long>(frames) * c8.getCyclesPerFrame());
+
+        float r = 0;
+        bool ended = c8.hasFaulted();
+        for(size_t w = 0; w < n; ++w) {
+            const watchRule& rule = rules[w];
+            uint8_t now = watched(i, rule.address);
+            switch(rule.kind) {
+            case watchReward:
+                r += rule.scale * static_cast<int8_t>(now - last[i * n + w]);
+                break;
+            case watchDoneEquals:
+                if(now == rule.value) ended = true;
+                break;
+            case watchDoneChanged:
+                if(now != start[i * n + w]) ended = true;
+                break;
+            }
+            last[i * n + w] = now;
+        }
+
+        reward[i] = r;
+        done[i] = ended ? 1 : 0;
+        observe(i);
+    }
+}
+
+// back to the state right after loading, with this episode's seed
+void chip8env::startEpisode(size_t i)
+{
+    chip8& c8 = *instances[i];
+    c8.loadState(initial);
+    c8.seed(seed + episodes[i]++ * count + i);
+
+    size_t n = rules.size();
+    for(size_t w = 0; w < n; ++w) {
+        last[i * n + w] = start[i * n + w] = watched(i, rules[w].address);
+    }
+}
+
+void chip8env::observe(size_t i)
+{
+    const uint64_t* display = instances[i]->getDisplay();
+    unsigned char* out = &obs[i * observationSize()];
+
+    if(format == packedBits) {
+        memcpy(out, display, 32 * sizeof(uint64_t));
+        return;
+    }
+    for(int y = 0; y < 32; ++y) {
+        uint64_t row = display[y];
+        for(int x = 0; x < 64; ++x) *out++ = (row >> (63 - x)) & 1;
+    }
+}
+
+uint8_t chip8env::watched(size_t i, uint16_t address) const
+{
+    const chip8& c8 = *instances[i];
+    if(address >= watchV) return c8.getRegisters()[address & 0xF];
+    return c8.peek(address);
+}
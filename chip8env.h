@@ -0,0 +1,92 @@
+//
+// Batched environments for training agents on chip8 games.
+//
+
+#ifndef CHIP8_CHIP8ENV_H
+#define CHIP8_CHIP8ENV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "chip8.h"
+
+/* Turns a watched byte into rewards and episode ends. The address is a
+ * memory address, or watchV + x for register VX (many games keep the
+ * score in a register).
+ *
+ *   watchReward         reward += scale * the byte's signed change
+ *   watchDoneEquals     the episode ends when the byte equals value
+ *   watchDoneChanged    the episode ends when the byte differs from its
+ *                       value at the start of the episode */
+enum watchKind { watchReward, watchDoneEquals, watchDoneChanged };
+static const uint16_t watchV = 0x1000;
+
+struct watchRule {
+    watchKind kind;
+    uint16_t address;
+    uint8_t value;
+    float scale;
+};
+
+/* N instances of one ROM stepped together. Each step writes every
+ * instance's observation into one contiguous buffer, along with a
+ * reward and a done flag per instance. All buffers are allocated by
+ * load() and reused, so stepping allocates nothing.
+ *
+ *   packedBits    the display as 32 uint64 rows, bit 63 = column 0
+ *                 (256 bytes per instance)
+ *   bytePlanes    64 * 32 bytes per instance, 1 for a lit pixel
+ *
+ * An instance that faults or hits a done rule is flagged done for that
+ * step, and starts a new episode at the start of its next step. Every
+ * episode starts from the state right after loading, with the CXNN
+ * seed seed + episode * N + i, so a run is reproducible from the seed
+ * and the actions. */
+class chip8env {
+public:
+    enum observation { packedBits, bytePlanes };
+
+    explicit chip8env(size_t count, observation = packedBits, uint64_t seed = 0);
+
+    /* load the ROM into every instance and reset them; false when the
+     * image is rejected */
+    bool load(const romImage&, chip8variant = variantChip8);
+    void addRule(const watchRule&);
+
+    /* start a new episode in every instance and write observations */
+    void reset();
+
+    /* Apply one action per instance (bit k = key k held) and run the
+     * given number of frames. */
+    void step(const uint16_t* actions, unsigned int frames = 1);
+
+    size_t size() const { return count; }
+    size_t observationSize() const { return format == packedBits ? 32 * sizeof(uint64_t) : 64 * 32; }
+    const unsigned char* observations() const { return obs.data(); }
+    const float* rewards() const { return reward.data(); }
+    const uint8_t* dones() const { return done.data(); }
+
+    chip8& instance(size_t i) { return *instances[i]; }
+
+private:
+    void startEpisode(size_t);
+    void observe(size_t);
+    uint8_t watched(size_t, uint16_t) const;
+
+    size_t count;
+    observation format;
+    uint64_t seed;
+    std::vector<std::unique_ptr<chip8>> instances;
+    chip8state initial;
+    std::vector<watchRule> rules;
+
+    std::vector<unsigned char> obs;
+    std::vector<float> reward;
+    std::vector<uint8_t> done;
+    std::vector<uint8_t> last;          // per instance and rule: value after the last step
+    std::vector<uint8_t> start;         // per instance and rule: value at episode start
+    std::vector<unsigned long long> episodes;
+};
+
+#endif //CHIP8_CHIP8ENV_H
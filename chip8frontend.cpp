@@ -0,0 +1,59 @@
+#include "chip8frontend.h"
+#include "chip8video.h"
+#include <cstring>
+using namespace std;
+
+chip8framebuffer::chip8framebuffer(unsigned int scale, uint32_t on, uint32_t off)
+        : scale(scale ? scale : 1)
+{
+    lit[0] = on >> 16;
+    lit[1] = on >> 8;
+    lit[2] = on;
+    unlit[0] = off >> 16;
+    unlit[1] = off >> 8;
+    unlit[2] = off;
+
+    rgb.resize(width() * height() * 3);
+    for(size_t i = 0; i < rgb.size(); i += 3) memcpy(&rgb[i], unlit, 3);
+}
+
+void chip8framebuffer::render(const chip8& c8, uint32_t rows)
+{
+    render(c8.getDisplay(), rows);
+}
+
+void chip8framebuffer::render(const uint64_t* display, uint32_t rows)
+{
+    size_t lineBytes = width() * 3;
+
+    for(int y = 0; y < 32; ++y) {
+        if((rows & (1u << y)) == 0) continue;
+
+        // draw the first line of the row, then copy it down
+        unsigned char* line = &rgb[y * scale * lineBytes];
+        unsigned char* pixel = line;
+        uint64_t bits = display[y];
+        for(int x = 63; x >= 0; --x) {
+            const unsigned char* colour = ((bits >> x) & 1) ? lit : unlit;
+            for(unsigned int s = 0; s < scale; ++s, pixel += 3) memcpy(pixel, colour, 3);
+        }
+        for(unsigned int s = 1; s < scale; ++s) memcpy(line + s * lineBytes, line, lineBytes);
+    }
+}
+
+chip8headless::chip8headless(unsigned int scale)
+        : screen(scale), video(nullptr), frames(0)
+{
+}
+
+void chip8headless::attach(chip8video* recorder)
+{
+    video = recorder;
+}
+
+void chip8headless::present(const chip8& c8, uint32_t rows)
+{
+    screen.render(c8, rows);
+    if(video) video->write(screen, rows);
+    ++frames;
+}
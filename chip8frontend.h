@@ -0,0 +1,73 @@
+//
+// Frontends: how a host shows the display and feeds the keypad, kept
+// apart from the core so that it builds without any windowing system.
+//
+
+#ifndef CHIP8_CHIP8FRONTEND_H
+#define CHIP8_CHIP8FRONTEND_H
+
+#include <cstdint>
+#include <vector>
+#include "chip8.h"
+
+class chip8video;
+
+/* A frontend shows frames and supplies input. After running a frame the
+ * host calls present() with the rows damaged since the last call
+ * (damagedRows, then acknowledgeDamage), every frame even when nothing
+ * changed, so that frontends that count time in frames (recorders) see
+ * each one. poll() fills the keypad and returns false once the user has
+ * asked to quit; beep() follows the sound timer. */
+class chip8frontend {
+public:
+    virtual ~chip8frontend() {}
+
+    virtual void present(const chip8&, uint32_t rows) = 0;
+    virtual bool poll(chip8&) { return true; }
+    virtual void beep(bool) {}
+};
+
+/* Software framebuffer: the display scaled up by a whole factor, as
+ * packed 8-bit RGB with one colour for lit pixels and one for the rest.
+ * render() redraws only the rows it is given. */
+class chip8framebuffer {
+public:
+    explicit chip8framebuffer(unsigned int scale = 1, uint32_t on = 0xFFFFFF, uint32_t off = 0x000000);
+
+    void render(const chip8&, uint32_t rows);
+    void render(const uint64_t* display, uint32_t rows);   // 32 rows, as getDisplay
+
+    unsigned int getScale() const { return scale; }
+    unsigned int width() const { return 64 * scale; }
+    unsigned int height() const { return 32 * scale; }
+
+    /* width() * height() * 3 bytes, top row first */
+    const unsigned char* pixels() const { return rgb.data(); }
+    const unsigned char* row(unsigned int y) const { return rgb.data() + y * width() * 3; }
+
+private:
+    unsigned int scale;
+    unsigned char lit[3];
+    unsigned char unlit[3];
+    std::vector<unsigned char> rgb;
+};
+
+/* Headless frontend: renders into a chip8framebuffer and, when a
+ * recorder is attached, writes every presented frame to it. */
+class chip8headless : public chip8frontend {
+public:
+    explicit chip8headless(unsigned int scale = 1);
+
+    void attach(chip8video*);
+    void present(const chip8&, uint32_t rows) override;
+
+    const chip8framebuffer& framebuffer() const { return screen; }
+    unsigned long long framesPresented() const { return frames; }
+
+private:
+    chip8framebuffer screen;
+    chip8video* video;
+    unsigned long long frames;
+};
+
+#endif //CHIP8_CHIP8FRONTEND_H
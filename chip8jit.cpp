@@ -0,0 +1,245 @@
+#include "chip8jit.h"
+#include "chip8.h"
+#include <cstring>
+
+#ifdef CHIP8_JIT_X64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// longest run compiled into one block
+static const int maxBlockLength = 64;
+
+// worst case bytes emitted per instruction, including the block exit
+static const size_t maxInstructionBytes = 24;
+
+chip8jit::chip8jit()
+        : code(nullptr), used(0), capacity(0)
+{
+#ifdef CHIP8_JIT_X64
+    size_t size = 1 << 20;
+    // never writable and executable at once: compile() opens the pages it
+    // writes to and makes them executable again when the block is done
+    void* buffer = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if(buffer != MAP_FAILED) {
+        code = static_cast<unsigned char*>(buffer);
+        capacity = size;
+    }
+#endif
+    flush();
+}
+
+chip8jit::~chip8jit()
+{
+#ifdef CHIP8_JIT_X64
+    if(code) munmap(code, capacity);
+#endif
+}
+
+bool chip8jit::supported()
+{
+#ifdef CHIP8_JIT_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+void chip8jit::flush()
+{
+    memset(blocks, 0, sizeof(blocks));
+    memset(covered, 0, sizeof(covered));
+    used = 0;
+}
+
+void chip8jit::invalidate(unsigned short addr, unsigned short len)
+{
+    // code writes are rare, so any overlap throws away every block
+    for(int i = addr; i < addr + len; ++i) {
+        if(covered[i & 0xFFF]) {
+            flush();
+            return;
+        }
+    }
+}
+
+// switch the pages holding code[begin, end) between writable and
+// executable; on failure the JIT turns itself off
+bool chip8jit::protect(size_t begin, size_t end, bool writable)
+{
+#ifdef CHIP8_JIT_X64
+    size_t page = sysconf(_SC_PAGESIZE);
+    begin &= ~(page - 1);
+    end = (end + page - 1) & ~(page - 1);
+    if(end > capacity) end = capacity;
+    if(mprotect(code + begin, end - begin, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0) return true;
+
+    munmap(code, capacity);
+    code = nullptr;
+    capacity = 0;
+#endif
+    return false;
+}
+
+unsigned long chip8jit::execute(chip8& c8, unsigned long budget)
+{
+    if(!code || c8.programCount > 0xFFF) return 0;
+
+    block& b = blocks[c8.programCount];
+    if(b.state == blockUnknown) {
+        compile(c8, c8.programCount, b);
+    }
+    if(b.state != blockCompiled || b.length > budget) return 0;
+
+    c8.programCount = b.code(c8.V, &c8.indexReg);
+    return b.length;
+}
+
+void chip8jit::emit(unsigned char byte)
+{
+    code[used++] = byte;
+}
+
+void chip8jit::emit16(unsigned short value)
+{
+    emit(value & 0xFF);
+    emit(value >> 8);
+}
+
+void chip8jit::emit32(unsigned int value)
+{
+    emit16(value & 0xFFFF);
+    emit16(value >> 16);
+}
+
+/* Register use in generated code (System V ABI):
+ *   rdi  V[]          rsi  &indexReg
+ *   al, dl  scratch   eax  returned programCount
+ * Every V access is a byte operand at [rdi + reg]. */
+void chip8jit::compile(const chip8& c8, unsigned short start, block& b)
+{
+    b.state = blockUncompilable;
+    covered[start] = covered[(start + 1) & 0xFFF] = 1;
+
+    if(capacity - used < maxBlockLength * maxInstructionBytes) {
+        flush();    // out of space, start over
+        covered[start] = covered[(start + 1) & 0xFFF] = 1;
+    }
+
+    size_t entry = used;
+    size_t limit = used + maxBlockLength * maxInstructionBytes;
+    if(!protect(entry, limit, true)) return;
+
+    unsigned short pc = start;
+    int length = 0;
+    bool exited = false;
+
+    while(!exited && length < maxBlockLength && pc < 0xFFF) {
+        instruction in = c8.predecode(c8.memory[pc] << 8 | c8.memory[pc + 1]);
+        unsigned char x = in.x, y = in.y;
+
+        // flag-setting ops are only compiled when VF isn't also an operand
+        bool flagOperands = (x == 0xF || y == 0xF);
+
+        switch(in.handler) {
+        case h6XNN: emit(0xC6); emit(0x47); emit(x); emit(in.nn); break;    // mov byte [rdi+x], nn
+        case h7XNN: emit(0x80); emit(0x47); emit(x); emit(in.nn); break;    // add byte [rdi+x], nn
+
+        case h8XY0:
+        case h8XY1:
+        case h8XY2:
+        case h8XY3:
+        {
+            static const unsigned char ops[] = { 0x88, 0x08, 0x20, 0x30 };  // mov, or, and, xor [rdi+x], al
+            emit(0x8A); emit(0x47); emit(y);                                // mov al, [rdi+y]
+            emit(ops[in.handler - h8XY0]); emit(0x47); emit(x);
+        }
+            break;
+
+        case h8XY4:
+            if(flagOperands) goto done;
+            emit(0x8A); emit(0x47); emit(y);                                // mov al, [rdi+y]
+            emit(0x00); emit(0x47); emit(x);                                // add [rdi+x], al
+            emit(0x0F); emit(0x92); emit(0x47); emit(0x0F);                 // setc [rdi+15]
+            break;
+
+        case h8XY5:
+            if(flagOperands) goto done;
+            emit(0x8A); emit(0x47); emit(y);                                // mov al, [rdi+y]
+            emit(0x28); emit(0x47); emit(x);                                // sub [rdi+x], al
+            emit(0x0F); emit(0x93); emit(0x47); emit(0x0F);                 // setnc [rdi+15]
+            break;
+
+        case h8XY7:
+            if(flagOperands) goto done;
+            emit(0x8A); emit(0x47); emit(y);                                // mov al, [rdi+y]
+            emit(0x2A); emit(0x47); emit(x);                                // sub al, [rdi+x]
+            emit(0x0F); emit(0x93); emit(0x47); emit(0x0F);                 // setnc [rdi+15]
+            emit(0x88); emit(0x47); emit(x);                                // mov [rdi+x], al
+            break;
+
+        case h8XY6:
+        case h8XYE:
+            if(x == 0xF) goto done;
+            emit(0xD0); emit(in.handler == h8XY6 ? 0x6F : 0x67); emit(x);   // shr/shl byte [rdi+x], 1
+            emit(0x0F); emit(0x92); emit(0x47); emit(0x0F);                 // setc [rdi+15]
+            break;
+
+        case hANNN:
+            emit(0x66); emit(0xC7); emit(0x06); emit16(in.nnn);             // mov word [rsi], nnn
+            break;
+
+        case h1NNN:
+            emit(0xB8); emit32(in.nnn);                                     // mov eax, nnn
+            emit(0xC3);                                                     // ret
+            exited = true;
+            break;
+
+        case h3XNN:
+        case h4XNN:
+        case h5XY0:
+        case h9XY0:
+            if(in.handler == h3XNN || in.handler == h4XNN) {
+                emit(0x80); emit(0x7F); emit(x); emit(in.nn);               // cmp byte [rdi+x], nn
+            }
+            else {
+                emit(0x8A); emit(0x57); emit(y);                            // mov dl, [rdi+y]
+                emit(0x38); emit(0x57); emit(x);                            // cmp [rdi+x], dl
+            }
+            emit(0xB8); emit32(pc + 2);                                     // mov eax, pc + 2
+            emit(0xB9); emit32(pc + 4);                                     // mov ecx, pc + 4
+            emit(0x0F);                                                     // cmove/cmovne eax, ecx
+            emit((in.handler == h3XNN || in.handler == h5XY0) ? 0x44 : 0x45);
+            emit(0xC1);
+            emit(0xC3);                                                     // ret
+            exited = true;
+            break;
+
+        default:
+            goto done;
+        }
+
+        covered[pc] = covered[pc + 1] = 1;
+        pc += 2;
+        ++length;
+    }
+done:
+
+    if(length == 0) {
+        used = entry;
+        protect(entry, limit, false);
+        return;
+    }
+
+    if(!exited) {
+        emit(0xB8); emit32(pc);                                             // mov eax, pc
+        emit(0xC3);                                                         // ret
+    }
+    if(!protect(entry, limit, false)) return;
+
+    b.state = blockCompiled;
+    b.length = length;
+    b.code = reinterpret_cast<blockFn>(code + entry);
+}
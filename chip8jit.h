@@ -0,0 +1,70 @@
+//
+// x86-64 dynamic recompiler for the chip8 core.
+//
+
+#ifndef CHIP8_CHIP8JIT_H
+#define CHIP8_CHIP8JIT_H
+
+#include <cstddef>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define CHIP8_JIT_X64
+#endif
+
+class chip8;
+
+/* Translates straight-line runs of CHIP-8 ALU instructions into
+ * native x86-64 code. A block starts at any address the core asks
+ * for and runs until a jump or skip (1NNN, 3XNN, 4XNN, 5XY0, 9XY0),
+ * which is compiled as the block's exit, or until an instruction the
+ * JIT doesn't handle (calls, returns, BNNN, draws, timers, memory),
+ * which is left for the interpreter. The code buffer is never writable
+ * and executable at once: the pages a block goes into are made
+ * writable while it is emitted and executable again afterwards. */
+class chip8jit {
+public:
+    chip8jit();
+    ~chip8jit();
+
+    /* true when native code can be generated on this host */
+    static bool supported();
+
+    /* run the block at the current programCount if it fits in the
+     * cycle budget. Returns the number of instructions executed, or
+     * 0 if the interpreter has to run the next instruction instead */
+    unsigned long execute(chip8&, unsigned long);
+
+    /* drop compiled code overlapping memory[addr, addr + len) */
+    void invalidate(unsigned short, unsigned short);
+    void flush();
+
+private:
+    chip8jit(const chip8jit&);
+    chip8jit& operator=(const chip8jit&);
+
+    /* compiled code: takes V[] and &indexReg, returns the next programCount */
+    typedef unsigned int (*blockFn)(unsigned char*, unsigned short*);
+
+    enum { blockUnknown = 0, blockCompiled, blockUncompilable };
+
+    struct block {
+        unsigned char state;
+        unsigned char length;   // instructions per run
+        blockFn code;
+    };
+
+    void compile(const chip8&, unsigned short, block&);
+    bool protect(size_t, size_t, bool);
+    void emit(unsigned char);
+    void emit16(unsigned short);
+    void emit32(unsigned int);
+
+    block blocks[4096];             // indexed by start address
+    unsigned char covered[4096];    // bytes read while compiling some block
+
+    unsigned char* code;            // code buffer, read-execute except while compile() writes it
+    size_t used;
+    size_t capacity;
+};
+
+#endif //CHIP8_CHIP8JIT_H
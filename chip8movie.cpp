@@ -0,0 +1,214 @@
+#include "chip8movie.h"
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+struct movieHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t romHash;
+    uint64_t seed;
+    uint32_t cyclesPerFrame;
+    uint32_t variant;           // 0 (chip8) in movies from before variants
+    uint64_t length;
+    uint32_t events;
+    uint32_t checkpoints;
+};
+
+// LEB128: 7 bits per byte, high bit set on all but the last
+static void putCount(FILE* out, uint64_t n)
+{
+    while(n >= 0x80) {
+        fputc(static_cast<int>((n & 0x7F) | 0x80), out);
+        n >>= 7;
+    }
+    fputc(static_cast<int>(n), out);
+}
+
+static bool getCount(FILE* in, uint64_t& n)
+{
+    n = 0;
+    for(int shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(in);
+        if(byte == EOF) return false;
+        n |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+bool chip8movie::save(const char* path) const
+{
+    FILE* out = fopen(path, "wb");
+    if(!out) return false;
+
+    movieHeader header;
+    memcpy(header.magic, "C8MV", 4);
+    header.version = movieVersion;
+    header.romHash = romHash;
+    header.seed = seed;
+    header.cyclesPerFrame = cyclesPerFrame;
+    header.variant = variant;
+    header.length = length;
+    header.events = static_cast<uint32_t>(events.size());
+    header.checkpoints = static_cast<uint32_t>(checkpoints.size());
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    uint64_t last = 0;
+    for(const movieEvent& e : events) {
+        putCount(out, e.cycle - last);
+        ok = ok && fwrite(&e.keys, sizeof(e.keys), 1, out) == 1;
+        last = e.cycle;
+    }
+
+    last = 0;
+    for(const movieCheckpoint& c : checkpoints) {
+        putCount(out, c.cycle - last);
+        ok = ok && fwrite(&c.hash, sizeof(c.hash), 1, out) == 1;
+        last = c.cycle;
+    }
+
+    return fclose(out) == 0 && ok;
+}
+
+bool chip8movie::load(const char* path)
+{
+    FILE* in = fopen(path, "rb");
+    if(!in) return false;
+
+    movieHeader header;
+    bool ok = fread(&header, sizeof(header), 1, in) == 1 &&
+              memcmp(header.magic, "C8MV", 4) == 0 && header.version == movieVersion;
+
+    events.clear();
+    checkpoints.clear();
+
+    uint64_t cycle = 0;
+    for(uint32_t i = 0; ok && i < header.events; ++i) {
+        uint64_t delta;
+        movieEvent e;
+        ok = getCount(in, delta) && fread(&e.keys, sizeof(e.keys), 1, in) == 1;
+        e.cycle = cycle += delta;
+        events.push_back(e);
+    }
+
+    cycle = 0;
+    for(uint32_t i = 0; ok && i < header.checkpoints; ++i) {
+        uint64_t delta;
+        movieCheckpoint c;
+        ok = getCount(in, delta) && fread(&c.hash, sizeof(c.hash), 1, in) == 1;
+        c.cycle = cycle += delta;
+        checkpoints.push_back(c);
+    }
+    fclose(in);
+
+    if(ok) {
+        romHash = header.romHash;
+        seed = header.seed;
+        cyclesPerFrame = header.cyclesPerFrame;
+        variant = header.variant < variantCount ? static_cast<chip8variant>(header.variant) : variantChip8;
+        length = header.length;
+    }
+    return ok;
+}
+
+uint64_t chip8movie::checkpointHash(const chip8& c8)
+{
+    return c8.stateHash();
+}
+
+uint16_t chip8movie::keyMask(const chip8& c8)
+{
+    uint16_t keys = 0;
+    for(int k = 0; k < 16; ++k) {
+        if(c8.keypad[k]) keys |= 1 << k;
+    }
+    return keys;
+}
+
+chip8recorder::chip8recorder(const chip8& c8, unsigned long checkpointCycles)
+        : c8(c8),
+          checkpointCycles(checkpointCycles ? checkpointCycles : 1),
+          nextCheckpoint(c8.getCycleCount() + this->checkpointCycles)
+{
+    movie.romHash = c8.getRomHash();
+    movie.seed = c8.getSeed();
+    movie.cyclesPerFrame = c8.getCyclesPerFrame();
+    movie.variant = c8.getVariant();
+    movie.events.push_back({ c8.getCycleCount(), chip8movie::keyMask(c8) });
+}
+
+void chip8recorder::update()
+{
+    uint64_t now = c8.getCycleCount();
+
+    // checkpoints land on whichever update comes first after they are due
+    if(now >= nextCheckpoint) {
+        movie.checkpoints.push_back({ now, chip8movie::checkpointHash(c8) });
+        nextCheckpoint = now + checkpointCycles;
+    }
+
+    uint16_t keys = chip8movie::keyMask(c8);
+    if(keys != movie.events.back().keys) {
+        if(movie.events.back().cycle == now) movie.events.back().keys = keys;
+        else movie.events.push_back({ now, keys });
+    }
+}
+
+void chip8recorder::truncate()
+{
+    uint64_t now = c8.getCycleCount();
+    while(movie.events.size() > 1 && movie.events.back().cycle > now) movie.events.pop_back();
+    while(!movie.checkpoints.empty() && movie.checkpoints.back().cycle > now) movie.checkpoints.pop_back();
+    nextCheckpoint = now + checkpointCycles;
+    update();
+}
+
+const chip8movie& chip8recorder::finish()
+{
+    update();
+    movie.length = c8.getCycleCount();
+    return movie;
+}
+
+replayResult replayMovie(chip8& c8, const chip8movie& movie, bool stopAtMismatch)
+{
+    replayResult result = { c8.getRomHash() == movie.romHash, -1, 0, 0 };
+    if(!result.romMatches) return result;
+
+    c8.seed(movie.seed);
+    c8.setCyclesPerFrame(movie.cyclesPerFrame);
+    c8.setVariant(movie.variant);
+
+    size_t event = 0;
+    size_t checkpoint = 0;
+    uint64_t cycle = c8.getCycleCount();
+
+    for(;;) {
+        while(event < movie.events.size() && movie.events[event].cycle <= cycle) {
+            for(int k = 0; k < 16; ++k) c8.keypad[k] = (movie.events[event].keys >> k) & 1;
+            ++event;
+        }
+        while(checkpoint < movie.checkpoints.size() && movie.checkpoints[checkpoint].cycle <= cycle) {
+            if(chip8movie::checkpointHash(c8) != movie.checkpoints[checkpoint].hash && result.firstMismatch < 0) {
+                result.firstMismatch = static_cast<long>(checkpoint);
+            }
+            ++checkpoint;
+            ++result.checkpointsChecked;
+        }
+        if(result.firstMismatch >= 0 && stopAtMismatch) break;
+
+        // run straight to the next event, checkpoint or the end
+        uint64_t stop = movie.length;
+        if(event < movie.events.size()) stop = min(stop, movie.events[event].cycle);
+        if(checkpoint < movie.checkpoints.size()) stop = min(stop, movie.checkpoints[checkpoint].cycle);
+        if(stop <= cycle) break;
+
+        c8.runCycles(static_cast<unsigned long>(stop - cycle));
+        cycle = stop;
+    }
+
+    result.cycles = cycle;
+    return result;
+}
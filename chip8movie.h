@@ -0,0 +1,101 @@
+//
+// Input movies: recorded keypad input for a chip8 run, replayed
+// headless with checkpoint verification.
+//
+
+#ifndef CHIP8_CHIP8MOVIE_H
+#define CHIP8_CHIP8MOVIE_H
+
+#include <cstdint>
+#include <vector>
+#include "chip8.h"
+
+/* A movie is everything needed to reproduce a run: the ROM it was
+ * recorded on (by content hash), the CXNN seed, the frame length, the
+ * interpreter variant and every keypad change, timestamped by cycle
+ * count. Checkpoints hold the machine's stateHash at given cycles, so a
+ * replay can tell exactly when it first diverged, in memory, timers or
+ * the stack as much as on screen. Version 1 movies hashed only the
+ * display, V, I and PC and can't be checked against this build.
+ *
+ * File layout, native byte order:
+ *   char[4] "C8MV", uint32 version, uint64 romHash, uint64 seed,
+ *   uint32 cyclesPerFrame, uint32 variant, uint64 length, uint32 events, uint32 checkpoints,
+ *   then per event: LEB128 cycles since the previous event, uint16 keys,
+ *   then per checkpoint: LEB128 cycles since the previous one, uint64 hash */
+struct movieEvent {
+    uint64_t cycle;
+    uint16_t keys;              // bit k set = key k down, from this cycle on
+};
+
+struct movieCheckpoint {
+    uint64_t cycle;
+    uint64_t hash;
+};
+
+static const uint32_t movieVersion = 2;
+
+class chip8movie {
+public:
+    uint64_t romHash = 0;
+    uint64_t seed = 0;
+    uint32_t cyclesPerFrame = chip8::defaultCyclesPerFrame;
+    chip8variant variant = variantChip8;
+    uint64_t length = 0;        // cycles recorded
+
+    std::vector<movieEvent> events;
+    std::vector<movieCheckpoint> checkpoints;
+
+    bool save(const char*) const;
+    bool load(const char*);
+
+    /* chip8::stateHash, as stored in checkpoints: memory, display,
+     * registers, stack, timers and the CXNN generator */
+    static uint64_t checkpointHash(const chip8&);
+
+    /* keypad as a key mask */
+    static uint16_t keyMask(const chip8&);
+};
+
+/* Records a running chip8, from construction (right after the ROM is
+ * loaded) until finish(). Call update() whenever the host may have
+ * changed the keypad, before running more cycles (once per frame is
+ * enough for frontends that only touch the keypad between frames). */
+class chip8recorder {
+public:
+    chip8recorder(const chip8&, unsigned long checkpointCycles = 600);
+
+    /* log a keypad change and any checkpoint that has come due */
+    void update();
+
+    /* drop everything after the current cycle, after the host rewinds
+     * or loads a state */
+    void truncate();
+
+    /* the movie up to the current cycle */
+    const chip8movie& finish();
+
+private:
+    const chip8& c8;
+    unsigned long checkpointCycles;
+    uint64_t nextCheckpoint;
+    chip8movie movie;
+};
+
+/* Result of a replay. firstMismatch is the index of the first
+ * checkpoint that didn't match, -1 when all of them did. */
+struct replayResult {
+    bool romMatches;
+    long firstMismatch;
+    size_t checkpointsChecked;
+    uint64_t cycles;
+};
+
+/* Replay a movie as fast as the host allows on an instance that has
+ * just loaded the movie's ROM (no cycles run yet). The instance takes
+ * the movie's seed, frame length and variant first, so it starts
+ * exactly as recorded. stopAtMismatch ends the replay at the first
+ * failed checkpoint. */
+replayResult replayMovie(chip8&, const chip8movie&, bool stopAtMismatch = true);
+
+#endif //CHIP8_CHIP8MOVIE_H
@@ -0,0 +1,76 @@
+#include "chip8profile.h"
+#include "chip8.h"
+#include <cstring>
+
+static_assert(hUnknown < chip8profile::maxHandlers, "opHandler doesn't fit the profile table");
+
+// report names for each opHandler
+static const char* handlerNames[] = {
+    "decode",
+    "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+    "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+    "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+    "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+    "unknown"
+};
+
+void chip8profile::clear()
+{
+    instructions = draws = collisions = clears = timerReads = keyWaits = 0;
+    memset(opcodes, 0, sizeof(opcodes));
+    memset(addresses, 0, sizeof(addresses));
+    busy = std::chrono::steady_clock::duration::zero();
+}
+
+double chip8profile::instructionsPerSecond() const
+{
+    double seconds = std::chrono::duration<double>(busy).count();
+    return (seconds > 0) ? instructions / seconds : 0;
+}
+
+void chip8profile::writeJson(FILE* out) const
+{
+    fprintf(out, "{\n");
+    fprintf(out, "  \"instructions\": %llu,\n", (unsigned long long)instructions);
+    fprintf(out, "  \"seconds\": %.6f,\n", std::chrono::duration<double>(busy).count());
+    fprintf(out, "  \"instructions_per_sec\": %.0f,\n", instructionsPerSecond());
+    fprintf(out, "  \"draws\": %llu,\n", (unsigned long long)draws);
+    fprintf(out, "  \"collisions\": %llu,\n", (unsigned long long)collisions);
+    fprintf(out, "  \"clears\": %llu,\n", (unsigned long long)clears);
+    fprintf(out, "  \"timer_reads\": %llu,\n", (unsigned long long)timerReads);
+    fprintf(out, "  \"key_waits\": %llu,\n", (unsigned long long)keyWaits);
+
+    fprintf(out, "  \"opcodes\": {");
+    bool first = true;
+    for(int h = 1; h <= hUnknown; ++h) {
+        if(opcodes[h] == 0) continue;
+        fprintf(out, "%s\n    \"%s\": %llu", first ? "" : ",", handlerNames[h], (unsigned long long)opcodes[h]);
+        first = false;
+    }
+    fprintf(out, "\n  },\n");
+
+    fprintf(out, "  \"heatmap\": [");
+    for(int a = 0; a < 4096; ++a) {
+        fprintf(out, "%s%s%llu", a ? "," : "", (a % 16) ? "" : "\n    ", (unsigned long long)addresses[a]);
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+// one row per value: kind,key,count
+void chip8profile::writeCsv(FILE* out) const
+{
+    fprintf(out, "kind,key,count\n");
+    fprintf(out, "counter,instructions,%llu\n", (unsigned long long)instructions);
+    fprintf(out, "counter,instructions_per_sec,%.0f\n", instructionsPerSecond());
+    fprintf(out, "counter,draws,%llu\n", (unsigned long long)draws);
+    fprintf(out, "counter,collisions,%llu\n", (unsigned long long)collisions);
+    fprintf(out, "counter,clears,%llu\n", (unsigned long long)clears);
+    fprintf(out, "counter,timer_reads,%llu\n", (unsigned long long)timerReads);
+    fprintf(out, "counter,key_waits,%llu\n", (unsigned long long)keyWaits);
+    for(int h = 1; h <= hUnknown; ++h) {
+        fprintf(out, "opcode,%s,%llu\n", handlerNames[h], (unsigned long long)opcodes[h]);
+    }
+    for(int a = 0; a < 4096; ++a) {
+        fprintf(out, "address,0x%03X,%llu\n", a, (unsigned long long)addresses[a]);
+    }
+}
@@ -0,0 +1,59 @@
+//
+// Execution profiler for the chip8 core.
+//
+
+#ifndef CHIP8_CHIP8PROFILE_H
+#define CHIP8_CHIP8PROFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+
+/* Profiling is compiled in with -DCHIP8_PROFILE=1. When it is 0 (the
+ * default) none of the counters exist. Like tracing, profiling runs
+ * every instruction through the interpreter so per-address counts
+ * are exact. */
+#ifndef CHIP8_PROFILE
+#define CHIP8_PROFILE 0
+#endif
+
+class chip8profile {
+public:
+    static const int maxHandlers = 64;
+
+    chip8profile() { clear(); }
+
+    void clear();
+
+    void count(unsigned char handler, unsigned short pc)
+    {
+        ++instructions;
+        ++opcodes[handler];
+        ++addresses[pc & 0xFFF];
+    }
+
+    /* wall-clock time spent in runCycles */
+    void startRun() { runStart = std::chrono::steady_clock::now(); }
+    void endRun() { busy += std::chrono::steady_clock::now() - runStart; }
+
+    double instructionsPerSecond() const;
+
+    /* report: counters, per-opcode counts and the 4096-entry heatmap */
+    void writeJson(FILE*) const;
+    void writeCsv(FILE*) const;
+
+    uint64_t instructions;
+    uint64_t opcodes[maxHandlers];      // indexed by opHandler
+    uint64_t addresses[4096];           // executions per program address
+    uint64_t draws;                     // DXYN
+    uint64_t collisions;                // DXYN that set VF
+    uint64_t clears;                    // 00E0
+    uint64_t timerReads;                // FX07, mostly delay-timer polling loops
+    uint64_t keyWaits;                  // cycles stalled in FX0A
+
+private:
+    std::chrono::steady_clock::time_point runStart;
+    std::chrono::steady_clock::duration busy;
+};
+
+#endif //CHIP8_CHIP8PROFILE_H
@@ -0,0 +1,67 @@
+//
+// Interpreter variants: the behaviours CHIP-8 interpreters disagree on,
+// as compile-time policies.
+//
+
+#ifndef CHIP8_CHIP8QUIRKS_H
+#define CHIP8_CHIP8QUIRKS_H
+
+#include <cstring>
+
+/* A quirk policy is a set of compile-time flags:
+ *
+ *   shiftVY        8XY6/8XYE shift VY into VX, rather than VX in place
+ *   indexAdvances  FX55/FX65 leave I one past the last register used
+ *   jumpVX         BNNN is BXNN, a jump to XNN + VX rather than NNN + V0
+ *   logicResetsVF  8XY1/8XY2/8XY3 clear VF
+ *   clipSprites    DXYN clips sprites at the screen edges instead of
+ *                  wrapping them (the start position always wraps)
+ *
+ * chip8 instantiates its quirk-dependent handlers once per policy and
+ * builds one dispatch table per variant from them, so each variant runs
+ * its own interpreter with no per-instruction checks. */
+template<bool ShiftVY, bool IndexAdvances, bool JumpVX, bool LogicResetsVF, bool ClipSprites>
+struct quirkPolicy {
+    static constexpr bool shiftVY = ShiftVY;
+    static constexpr bool indexAdvances = IndexAdvances;
+    static constexpr bool jumpVX = JumpVX;
+    static constexpr bool logicResetsVF = LogicResetsVF;
+    static constexpr bool clipSprites = ClipSprites;
+};
+
+/*   chip8          this interpreter as it always was, the default
+ *   cosmac         the original COSMAC VIP interpreter
+ *   schip-quirks   SUPER-CHIP 1.1's quirks only: the machine is still a
+ *                  64x32 CHIP-8, with no hi-res mode or extra opcodes
+ *   xochip-quirks  XO-CHIP's quirks only: no extra opcodes, bit planes
+ *                  or 64 KB memory
+ *
+ * The -quirks variants are not SUPER-CHIP or XO-CHIP interpreters, and
+ * ROMs written for those machines won't run on them. The machines
+ * themselves are open work, listed under "Not done yet" in README.md;
+ * they will be new variants next to these, not changes to them. */
+typedef quirkPolicy<false, true,  false, false, false> chip8Quirks;
+typedef quirkPolicy<true,  true,  false, true,  true>  cosmacQuirks;
+typedef quirkPolicy<false, false, true,  false, true>  schipQuirks;
+typedef quirkPolicy<true,  true,  false, false, false> xochipQuirks;
+
+enum chip8variant { variantChip8, variantCosmac, variantSchipQuirks, variantXochipQuirks, variantCount };
+
+inline const char* variantName(chip8variant v)
+{
+    static const char* names[variantCount] = { "chip8", "cosmac", "schip-quirks", "xochip-quirks" };
+    return v < variantCount ? names[v] : "unknown";
+}
+
+inline bool variantFromName(const char* name, chip8variant& v)
+{
+    for(int i = 0; i < variantCount; ++i) {
+        if(strcmp(name, variantName(static_cast<chip8variant>(i))) == 0) {
+            v = static_cast<chip8variant>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif //CHIP8_CHIP8QUIRKS_H
@@ -0,0 +1,122 @@
+#include "chip8rewind.h"
+#include <cstring>
+using namespace std;
+
+chip8rewind::chip8rewind(size_t capacity, size_t keyframeInterval)
+        : capacity(capacity ? capacity : 1),
+          keyframeInterval(keyframeInterval ? keyframeInterval : 1),
+          total(0)
+{
+}
+
+void chip8rewind::clear()
+{
+    segments.clear();
+    total = 0;
+}
+
+void chip8rewind::push(const chip8state& s)
+{
+    if(segments.empty() || segments.back().frames() >= keyframeInterval) {
+        segments.emplace_back();
+        segments.back().keyframe = s;
+    }
+    else {
+        segment& seg = segments.back();
+        seg.offsets.push_back(static_cast<uint32_t>(seg.deltas.size()));
+        encode(reinterpret_cast<const uint8_t*>(&seg.keyframe), reinterpret_cast<const uint8_t*>(&s),
+               sizeof(chip8state), seg.deltas);
+    }
+    ++total;
+
+    // drop the oldest segment once the rest still covers the capacity
+    while(total - segments.front().frames() >= capacity) {
+        total -= segments.front().frames();
+        segments.pop_front();
+    }
+}
+
+bool chip8rewind::rewind(size_t back, chip8state& s)
+{
+    if(back >= total) return false;
+
+    // walk back from the newest segment to the one holding the state
+    size_t keep = total - back;     // states left afterwards, including this one
+    while(total - segments.back().frames() >= keep) {
+        total -= segments.back().frames();
+        segments.pop_back();
+    }
+
+    segment& seg = segments.back();
+    size_t index = seg.frames() - (total - keep) - 1;
+    s = seg.keyframe;
+    if(index > 0) {
+        const uint8_t* begin = seg.deltas.data() + seg.offsets[index - 1];
+        const uint8_t* end = seg.deltas.data() + ((index < seg.offsets.size()) ? seg.offsets[index] : seg.deltas.size());
+        decode(begin, end, reinterpret_cast<uint8_t*>(&s));
+
+        seg.deltas.resize(end - seg.deltas.data());
+    }
+    seg.offsets.resize(index);
+    if(index == 0) seg.deltas.clear();
+    total = keep;
+    return true;
+}
+
+size_t chip8rewind::bytesUsed() const
+{
+    size_t bytes = 0;
+    for(const segment& seg : segments) {
+        bytes += sizeof(seg.keyframe) + seg.deltas.size() + seg.offsets.size() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+static void putCount(vector<uint8_t>& out, size_t n)
+{
+    // LEB128: 7 bits per byte, high bit set on all but the last
+    while(n >= 0x80) {
+        out.push_back(static_cast<uint8_t>(n | 0x80));
+        n >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(n));
+}
+
+static size_t getCount(const uint8_t*& p)
+{
+    size_t n = 0;
+    for(int shift = 0; ; shift += 7) {
+        n |= static_cast<size_t>(*p & 0x7F) << shift;
+        if((*p++ & 0x80) == 0) return n;
+    }
+}
+
+/* Delta format: pairs of (count of unchanged bytes, count of changed
+ * bytes) followed by the changed bytes XORed with the keyframe. A
+ * single unchanged byte between two changes stays inside the literal
+ * run rather than starting a new pair. */
+void chip8rewind::encode(const uint8_t* base, const uint8_t* s, size_t size, vector<uint8_t>& out)
+{
+    size_t i = 0;
+    while(i < size) {
+        size_t start = i;
+        while(i < size && base[i] == s[i]) ++i;
+        if(i == size) break;
+        putCount(out, i - start);
+
+        start = i;
+        while(i < size && (base[i] != s[i] || (i + 1 < size && base[i + 1] != s[i + 1]))) ++i;
+        putCount(out, i - start);
+        for(size_t j = start; j < i; ++j) out.push_back(base[j] ^ s[j]);
+    }
+}
+
+// s holds the keyframe on entry
+void chip8rewind::decode(const uint8_t* p, const uint8_t* end, uint8_t* s)
+{
+    while(p < end) {
+        s += getCount(p);
+        size_t changed = getCount(p);
+        for(size_t j = 0; j < changed; ++j) *s++ ^= *p++;
+    }
+}
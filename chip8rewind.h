@@ -0,0 +1,56 @@
+//
+// Rewind buffer of recent chip8 states.
+//
+
+#ifndef CHIP8_CHIP8REWIND_H
+#define CHIP8_CHIP8REWIND_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "chip8state.h"
+
+/* Keeps the last `capacity` pushed states (typically one per frame).
+ * States are grouped in segments: a full keyframe followed by up to
+ * keyframeInterval - 1 deltas, each the XOR of its state against the
+ * keyframe, run-length encoded. Between frames only a few bytes of
+ * memory and display change, so a delta is usually tens of bytes.
+ * Any state is rebuilt from its keyframe plus a single delta.
+ * Whole segments are dropped from the old end to keep the memory
+ * bounded. */
+class chip8rewind {
+public:
+    explicit chip8rewind(size_t capacity, size_t keyframeInterval = 60);
+
+    void push(const chip8state&);
+    void clear();
+
+    /* number of states held */
+    size_t frames() const { return total; }
+
+    /* Fetch the state `back` pushes before the newest (0 = newest) and
+     * discard everything newer, so play resumes from there. False when
+     * fewer than back + 1 states are held. */
+    bool rewind(size_t back, chip8state&);
+
+    /* bytes held in keyframes and deltas */
+    size_t bytesUsed() const;
+
+private:
+    struct segment {
+        chip8state keyframe;
+        std::vector<uint8_t> deltas;        // encoded deltas, back to back
+        std::vector<uint32_t> offsets;      // start of each delta in deltas
+        size_t frames() const { return offsets.size() + 1; }
+    };
+
+    static void encode(const uint8_t*, const uint8_t*, size_t, std::vector<uint8_t>&);
+    static void decode(const uint8_t*, const uint8_t*, uint8_t*);
+
+    size_t capacity;
+    size_t keyframeInterval;
+    size_t total;
+    std::deque<segment> segments;
+};
+
+#endif //CHIP8_CHIP8REWIND_H
@@ -0,0 +1,79 @@
+#include "chip8roms.h"
+#include "chip8.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+chip8roms::~chip8roms()
+{
+    for(const mapping& m : mappings) munmap(m.base, m.length);
+}
+
+const romImage* chip8roms::open(const string& path, string& error)
+{
+    lock_guard<mutex> guard(lock);
+
+    auto known = byPath.find(path);
+    if(known != byPath.end()) return known->second;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        error = "Could not open " + path;
+        return nullptr;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        error = path + " is not a regular file";
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    if(size == 0 || size > maxRomSize) {
+        ::close(fd);
+        error = path + (size ? " is too large; not enough memory available." : " is empty.");
+        return nullptr;
+    }
+
+    void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(base == MAP_FAILED) {
+        error = "Could not map " + path;
+        return nullptr;
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(base);
+    uint64_t hash = contentHash(bytes, size);
+
+    // the same ROM under another name: keep the first mapping
+    auto same = byHash.find(hash);
+    if(same != byHash.end() && same->second->size == size) {
+        munmap(base, size);
+        byPath[path] = same->second;
+        return same->second;
+    }
+
+    mappings.push_back({ base, size });
+    images.emplace_back(new romImage{ path, bytes, size, hash, memoryKeys(bytes, size, 0x200) });
+    const romImage* image = images.back().get();
+    byPath[path] = image;
+    byHash[hash] = image;
+    return image;
+}
+
+const romImage* chip8roms::find(uint64_t hash) const
+{
+    lock_guard<mutex> guard(lock);
+
+    auto found = byHash.find(hash);
+    return (found != byHash.end()) ? found->second : nullptr;
+}
+
+size_t chip8roms::count() const
+{
+    lock_guard<mutex> guard(lock);
+    return images.size();
+}
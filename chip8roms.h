@@ -0,0 +1,64 @@
+//
+// Shared, memory-mapped ROM images.
+//
+
+#ifndef CHIP8_CHIP8ROMS_H
+#define CHIP8_CHIP8ROMS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/* programs load at 0x200 and may fill the rest of memory */
+static const size_t maxRomSize = 4096 - 512;
+
+/* A ROM's bytes, read-only, with the contentHash identifying it and
+ * the memoryKeys of the bytes loaded at 0x200 */
+struct romImage {
+    std::string path;
+    const unsigned char* bytes;
+    size_t size;
+    uint64_t hash;
+    uint64_t keys;
+};
+
+/* A library of ROM images. Each file is mapped once and indexed by
+ * path and by content hash; files with identical contents share one
+ * image. Images stay valid until the library is destroyed, so any
+ * number of instances on any thread can load from them with a single
+ * copy (chip8::loadImage). Opening is thread-safe. */
+class chip8roms {
+public:
+    chip8roms() {}
+    ~chip8roms();
+
+    chip8roms(const chip8roms&) = delete;
+    chip8roms& operator=(const chip8roms&) = delete;
+
+    /* the image for a file, mapping it on first use; null when the
+     * file can't be read or isn't a valid ROM, with the reason in error */
+    const romImage* open(const std::string&, std::string& error);
+
+    /* the image with this content hash, null when none is loaded */
+    const romImage* find(uint64_t) const;
+
+    size_t count() const;
+
+private:
+    struct mapping {
+        void* base;
+        size_t length;
+    };
+
+    mutable std::mutex lock;
+    std::vector<std::unique_ptr<romImage>> images;
+    std::vector<mapping> mappings;
+    std::unordered_map<std::string, const romImage*> byPath;
+    std::unordered_map<uint64_t, const romImage*> byHash;
+};
+
+#endif //CHIP8_CHIP8ROMS_H
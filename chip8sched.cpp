@@ -0,0 +1,200 @@
+#include "chip8sched.h"
+using namespace std;
+
+chip8sched::eventQueue::eventQueue(size_t capacity)
+        : tail(0), head(0)
+{
+    size_t size = 1;
+    while(size < capacity) size <<= 1;
+    slots = vector<slot>(size);
+    mask = size - 1;
+    for(size_t i = 0; i < size; ++i) slots[i].sequence.store(i, memory_order_relaxed);
+}
+
+bool chip8sched::eventQueue::push(const event& e)
+{
+    size_t pos = tail.load(memory_order_relaxed);
+    for(;;) {
+        slot& s = slots[pos & mask];
+        size_t sequence = s.sequence.load(memory_order_acquire);
+        if(sequence == pos) {
+            if(tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                s.value = e;
+                s.sequence.store(pos + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if(static_cast<ptrdiff_t>(sequence - pos) < 0) {
+            return false;   // the consumer hasn't freed this slot yet: full
+        }
+        else {
+            pos = tail.load(memory_order_relaxed);
+        }
+    }
+}
+
+bool chip8sched::eventQueue::pop(event& e)
+{
+    slot& s = slots[head & mask];
+    if(s.sequence.load(memory_order_acquire) != head + 1) return false;
+    e = s.value;
+    s.sequence.store(head + mask + 1, memory_order_release);
+    ++head;
+    return true;
+}
+
+chip8sched::chip8sched(unsigned int threads, size_t queueCapacity)
+        : events(queueCapacity), frame(0), generation(0), active(0), next(0), stopping(false)
+{
+    // the thread calling runFrame takes a share too
+    for(unsigned int t = 1; t < threads; ++t) {
+        workers.emplace_back(&chip8sched::worker, this);
+    }
+}
+
+chip8sched::~chip8sched()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    started.notify_all();
+    for(auto& w : workers) w.join();
+}
+
+size_t chip8sched::add(chip8& c8)
+{
+    session s;
+    s.c8 = &c8;
+    s.parked = false;
+    s.parkedAt = frame;
+    s.wakeAt = never;
+    s.idle = 0;
+    sessions.push_back(s);
+    running.push_back(sessions.size() - 1);
+    return sessions.size() - 1;
+}
+
+bool chip8sched::post(size_t session, unsigned char key, bool down)
+{
+    event e;
+    e.session = session;
+    e.key = key;
+    e.down = down;
+    return events.push(e);
+}
+
+void chip8sched::runFrame()
+{
+    // key events: a parked session first runs the frames it missed with
+    // the keypad it had, then sees the change
+    event e;
+    while(events.pop(e)) {
+        if(e.session >= sessions.size()) continue;
+        wake(e.session);
+        sessions[e.session].c8->keypad[e.key & 0xF] = e.down ? 1 : 0;
+    }
+
+    while(!timers.empty() && timers.top().at <= frame) {
+        wakeup due = timers.top();
+        timers.pop();
+        if(sessions[due.session].wakeAt == due.at) wake(due.session);
+    }
+
+    if(workers.empty()) {
+        next.store(0, memory_order_relaxed);
+        runShare();
+    }
+    else {
+        unique_lock<mutex> guard(lock);
+        next.store(0, memory_order_relaxed);
+        active = workers.size();
+        ++generation;
+        started.notify_all();
+        guard.unlock();
+
+        runShare();
+
+        guard.lock();
+        finished.wait(guard, [this]() { return active == 0; });
+    }
+    ++frame;
+
+    // park whatever will sit in an idle loop for at least a whole frame
+    size_t kept = 0;
+    for(size_t id : running) {
+        session& s = sessions[id];
+        unsigned long frameCycles = s.c8->getCyclesPerFrame();
+        if(s.idle < frameCycles) {
+            running[kept++] = id;
+            continue;
+        }
+
+        s.parked = true;
+        s.parkedAt = frame;
+        s.wakeAt = never;
+        if(s.idle != chip8::idleForever) {
+            s.wakeAt = frame + s.idle / frameCycles;
+            wakeup w;
+            w.at = s.wakeAt;
+            w.session = id;
+            timers.push(w);
+        }
+    }
+    running.resize(kept);
+}
+
+void chip8sched::sync(size_t id)
+{
+    if(sessions[id].parked) catchUp(sessions[id]);
+}
+
+void chip8sched::wake(size_t id)
+{
+    session& s = sessions[id];
+    if(!s.parked) return;
+
+    catchUp(s);
+    s.parked = false;
+    s.wakeAt = never;
+    s.idle = 0;
+    running.push_back(id);
+}
+
+void chip8sched::catchUp(session& s)
+{
+    unsigned long long missed = frame - s.parkedAt;
+    if(missed > 0) s.c8->runCycles(missed * s.c8->getCyclesPerFrame());
+    s.parkedAt = frame;
+}
+
+// run sessions off the shared run list until it is used up
+void chip8sched::runShare()
+{
+    size_t count = running.size();
+    for(;;) {
+        size_t i = next.fetch_add(1, memory_order_relaxed);
+        if(i >= count) return;
+        session& s = sessions[running[i]];
+        s.c8->runFrame();
+        s.idle = s.c8->idleCycles();
+    }
+}
+
+void chip8sched::worker()
+{
+    unsigned long long seen = 0;
+    for(;;) {
+        {
+            unique_lock<mutex> guard(lock);
+            started.wait(guard, [&]() { return stopping || generation != seen; });
+            if(stopping) return;
+            seen = generation;
+        }
+
+        runShare();
+
+        lock_guard<mutex> guard(lock);
+        if(--active == 0) finished.notify_one();
+    }
+}
@@ -0,0 +1,124 @@
+//
+// Frame scheduler for many chip8 sessions that parks the idle ones.
+//
+
+#ifndef CHIP8_CHIP8SCHED_H
+#define CHIP8_CHIP8SCHED_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+
+/* Runs many chip8 sessions one 60 Hz frame at a time on a pool of
+ * worker threads. A session that finishes a frame waiting on the keypad
+ * (FX0A, a key-polling loop) or on the delay timer (see idleCycles) is
+ * parked: it leaves the run list and costs nothing until a key event for
+ * it arrives or its timer is due. A parked session is suspended at its
+ * waiting instruction, so waking it is a matter of running the frames it
+ * missed in a single runCycles call, which the idle-loop fast path turns
+ * into a clock update. Its state then matches a session that ran every
+ * frame.
+ *
+ * Key events can be posted from any thread. They go through a lock-free
+ * queue and are applied at the start of the next frame. Everything else,
+ * including reading a session's state, belongs to the thread that calls
+ * runFrame(). */
+class chip8sched {
+public:
+    explicit chip8sched(unsigned int threads = std::thread::hardware_concurrency(),
+                        size_t queueCapacity = 4096);
+    ~chip8sched();
+
+    /* sessions stay owned by the caller and must outlive the scheduler;
+     * returns the session's id */
+    size_t add(chip8&);
+
+    /* thread-safe; false when the event queue is full */
+    bool post(size_t session, unsigned char key, bool down);
+
+    /* apply pending events and due timers, then run every session that
+     * isn't parked for one frame */
+    void runFrame();
+
+    /* run a parked session's missed frames so that its clock and timers
+     * are current; it stays parked */
+    void sync(size_t session);
+
+    bool isParked(size_t session) const { return sessions[session].parked; }
+    size_t sessionCount() const { return sessions.size(); }
+    size_t runnableCount() const { return running.size(); }
+    unsigned long long framesRun() const { return frame; }
+
+    static const unsigned long long never = ~0ULL;
+
+private:
+    struct session {
+        chip8* c8;
+        bool parked;
+        unsigned long long parkedAt;    // frames run when it was parked
+        unsigned long long wakeAt;      // frame it is due back, or never
+        unsigned long idle;             // idleCycles after its last frame
+    };
+
+    struct event {
+        size_t session;
+        unsigned char key;
+        bool down;
+    };
+
+    /* Bounded multi-producer, single-consumer ring. Each slot carries a
+     * sequence number that says whether it is free for the producer
+     * claiming position n (sequence == n) or filled for the consumer
+     * (sequence == n + 1). */
+    class eventQueue {
+    public:
+        explicit eventQueue(size_t);
+        bool push(const event&);
+        bool pop(event&);
+
+    private:
+        struct slot {
+            std::atomic<size_t> sequence;
+            event value;
+        };
+        std::vector<slot> slots;
+        size_t mask;
+        std::atomic<size_t> tail;       // next position to claim
+        size_t head;                    // next position to read, consumer only
+    };
+
+    /* timer wake-ups; entries left behind by sessions that were woken
+     * early are recognised by their wake frame and dropped */
+    struct wakeup {
+        unsigned long long at;
+        size_t session;
+        bool operator>(const wakeup& other) const { return at > other.at; }
+    };
+
+    void wake(size_t);
+    void catchUp(session&);
+    void runShare();
+    void worker();
+
+    std::vector<session> sessions;
+    std::vector<size_t> running;
+    std::priority_queue<wakeup, std::vector<wakeup>, std::greater<wakeup>> timers;
+    eventQueue events;
+    unsigned long long frame;
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable started;
+    std::condition_variable finished;
+    unsigned long long generation;      // frames handed to the workers
+    unsigned int active;                // workers still running this frame
+    std::atomic<size_t> next;           // next entry of running to claim
+    bool stopping;
+};
+
+#endif //CHIP8_CHIP8SCHED_H
@@ -0,0 +1,173 @@
+#include "chip8shm.h"
+#include "chip8.h"
+#include <iostream>
+#include <new>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "sequence counters must be lock-free to work across processes");
+
+static const char shmTag[4] = { 'C', '8', 'S', 'H' };
+
+chip8publisher::chip8publisher()
+        : header(nullptr), slots(nullptr), size(0), frames(0)
+{
+}
+
+chip8publisher::~chip8publisher()
+{
+    if(!header) return;
+    munmap(header, size);
+    shm_unlink(name.c_str());
+}
+
+bool chip8publisher::create(const string& objectName, uint32_t slotCount)
+{
+    if(slotCount == 0) slotCount = 1;
+
+    int fd = shm_open(objectName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        cerr << "Could not create shared memory " << objectName << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    size_t bytes = sizeof(shmHeader) + slotCount * sizeof(shmSlot);
+    void* mapped = MAP_FAILED;
+    if(ftruncate(fd, bytes) == 0) {
+        mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if(mapped == MAP_FAILED) {
+        cerr << "Could not map shared memory " << objectName << ": " << strerror(errno) << endl;
+        shm_unlink(objectName.c_str());
+        return false;
+    }
+
+    name = objectName;
+    size = bytes;
+    header = new(mapped) shmHeader();
+    slots = reinterpret_cast<shmSlot*>(header + 1);
+    for(uint32_t i = 0; i < slotCount; ++i) {
+        new(&slots[i]) shmSlot();
+        slots[i].sequence.store(0, memory_order_relaxed);
+    }
+
+    header->version = shmVersion;
+    header->slots = slotCount;
+    header->slotSize = sizeof(shmSlot);
+    header->published.store(0, memory_order_relaxed);
+
+    // readers check the tag last, so it goes in once the rest is set
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->tag, shmTag, sizeof(shmTag));
+    return true;
+}
+
+void chip8publisher::publish(const chip8& c8)
+{
+    uint64_t n = frames++;
+    shmSlot& slot = slots[n % header->slots];
+
+    slot.sequence.store(2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    shmFrame& f = slot.frame;
+    f.number = n;
+    f.cycle = c8.getCycleCount();
+    f.romHash = c8.getRomHash();
+    memcpy(f.display, c8.getDisplay(), sizeof(f.display));
+    memcpy(f.V, c8.getRegisters(), sizeof(f.V));
+    f.indexReg = c8.getIndexReg();
+    f.programCount = c8.getProgramCount();
+    f.delayTimer = c8.getDelayTimer();
+    f.soundTimer = c8.getSoundTimer();
+    f.variant = static_cast<uint8_t>(c8.getVariant());
+    f.faulted = c8.hasFaulted() ? 1 : 0;
+
+    slot.sequence.store(2 * n + 2, memory_order_release);
+    header->published.store(n + 1, memory_order_release);
+}
+
+chip8subscriber::chip8subscriber()
+        : header(nullptr), slots(nullptr), count(0), size(0)
+{
+}
+
+chip8subscriber::~chip8subscriber()
+{
+    close();
+}
+
+bool chip8subscriber::open(const string& name)
+{
+    close();
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0) {
+        cerr << "Could not open shared memory " << name << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(shmHeader)) {
+        mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if(mapped == MAP_FAILED) {
+        cerr << name << " is not a chip8 frame export" << endl;
+        return false;
+    }
+
+    const shmHeader* h = static_cast<const shmHeader*>(mapped);
+    size_t bytes = info.st_size;
+    if(memcmp(h->tag, shmTag, sizeof(shmTag)) != 0 || h->version != shmVersion || h->slotSize != sizeof(shmSlot) ||
+       h->slots == 0 || bytes < sizeof(shmHeader) + static_cast<size_t>(h->slots) * sizeof(shmSlot)) {
+        cerr << name << " is not a chip8 frame export this build can read" << endl;
+        munmap(const_cast<shmHeader*>(h), bytes);
+        return false;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    header = h;
+    slots = reinterpret_cast<const shmSlot*>(h + 1);
+    count = h->slots;
+    size = bytes;
+    return true;
+}
+
+void chip8subscriber::close()
+{
+    if(header) munmap(const_cast<shmHeader*>(header), size);
+    header = nullptr;
+    slots = nullptr;
+    count = 0;
+}
+
+bool chip8subscriber::read(uint64_t n, shmFrame& out) const
+{
+    const shmSlot& slot = slots[n % count];
+
+    uint64_t before = slot.sequence.load(memory_order_acquire);
+    if(before != 2 * n + 2) return false;       // not written yet, being rewritten or overwritten
+
+    memcpy(&out, &slot.frame, sizeof(out));
+    atomic_thread_fence(memory_order_acquire);
+    return slot.sequence.load(memory_order_relaxed) == before;
+}
+
+bool chip8subscriber::latest(shmFrame& out) const
+{
+    // the newest frame can only be lost to a publisher that laps the
+    // whole ring meanwhile; start over from the new newest then
+    for(;;) {
+        uint64_t count = published();
+        if(count == 0) return false;
+        if(read(count - 1, out)) return true;
+    }
+}
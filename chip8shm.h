@@ -0,0 +1,113 @@
+//
+// Shared-memory export of a running chip8's frames and registers for
+// other processes on the same host.
+//
+
+#ifndef CHIP8_CHIP8SHM_H
+#define CHIP8_CHIP8SHM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class chip8;
+
+/* A POSIX shared-memory object (shm_open) holding a header and a ring
+ * of frame slots. The publisher writes frame n into slot n % slots
+ * under a seqlock: the slot's sequence is odd (2n + 1) while it is
+ * being written and 2n + 2 once frame n is complete. Readers copy a
+ * slot out and check the sequence before and after; a slot that was
+ * overwritten meanwhile is simply reported as gone. Readers never
+ * write to the object, so any number of them can map it read-only
+ * without slowing the publisher or each other, and neither side makes
+ * a system call per frame.
+ *
+ * Layout, native byte order: shmHeader, then slots * shmSlot. */
+static const uint32_t shmVersion = 1;
+
+struct shmFrame {
+    uint64_t number;            // frames published before this one
+    uint64_t cycle;             // instructions run since the ROM was loaded
+    uint64_t romHash;
+    uint64_t display[32];       // one word per row, pixel x at bit (63 - x)
+    uint8_t V[16];
+    uint16_t indexReg;
+    uint16_t programCount;
+    uint8_t delayTimer;
+    uint8_t soundTimer;
+    uint8_t variant;            // chip8variant
+    uint8_t faulted;
+};
+
+struct shmSlot {
+    std::atomic<uint64_t> sequence;
+    shmFrame frame;
+};
+
+struct shmHeader {
+    char tag[4];                // "C8SH"
+    uint32_t version;
+    uint32_t slots;
+    uint32_t slotSize;          // sizeof(shmSlot), so mismatched builds are refused
+    std::atomic<uint64_t> published;    // frames published so far
+};
+
+/* Creates the object and publishes into it; the object is unlinked
+ * when the publisher goes away (readers that have it mapped keep
+ * their mapping). publish() copies one frame's state into the ring,
+ * about 400 bytes, and is meant to be called by the thread that runs
+ * the instance, between frames. */
+class chip8publisher {
+public:
+    chip8publisher();
+    ~chip8publisher();
+
+    /* name is a shm_open name such as "/chip8"; false with a message on
+     * stderr when it can't be created */
+    bool create(const std::string& name, uint32_t slots = 16);
+    void publish(const chip8&);
+
+    bool isOpen() const { return header != nullptr; }
+    unsigned long long framesPublished() const { return frames; }
+
+private:
+    std::string name;
+    shmHeader* header;
+    shmSlot* slots;
+    size_t size;
+    unsigned long long frames;
+};
+
+/* Maps a publisher's object read-only. Doesn't need the chip8 core,
+ * so a consumer links chip8shm.cpp alone. */
+class chip8subscriber {
+public:
+    chip8subscriber();
+    ~chip8subscriber();
+
+    /* false with a message on stderr when there is no such object or
+     * its layout differs from this build's */
+    bool open(const std::string& name);
+    void close();
+
+    /* frames published so far; the newest is published() - 1 */
+    uint64_t published() const { return header->published.load(std::memory_order_acquire); }
+    uint32_t slotCount() const { return count; }
+
+    /* Copy frame n out. False when it hasn't been published yet, or
+     * when the ring has moved past it (more than slotCount() frames
+     * behind the newest). */
+    bool read(uint64_t n, shmFrame&) const;
+
+    /* the newest frame; false when nothing has been published */
+    bool latest(shmFrame&) const;
+
+private:
+    const shmHeader* header;
+    const shmSlot* slots;
+    uint32_t count;     // header->slots as checked by open(), which the publisher can't change under us
+    size_t size;
+};
+
+#endif //CHIP8_CHIP8SHM_H
@@ -0,0 +1,21 @@
+#include "chip8state.h"
+#include <cstdio>
+
+bool writeState(const char* path, const chip8state& s)
+{
+    FILE* out = fopen(path, "wb");
+    if(!out) return false;
+
+    bool ok = fwrite(&s, sizeof(s), 1, out) == 1;
+    return fclose(out) == 0 && ok;
+}
+
+bool readState(const char* path, chip8state& s)
+{
+    FILE* in = fopen(path, "rb");
+    if(!in) return false;
+
+    bool ok = fread(&s, sizeof(s), 1, in) == 1 && fgetc(in) == EOF;
+    fclose(in);
+    return ok && stateValid(s);
+}
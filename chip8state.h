@@ -0,0 +1,57 @@
+//
+// Save states for the chip8 core.
+//
+
+#ifndef CHIP8_CHIP8STATE_H
+#define CHIP8_CHIP8STATE_H
+
+#include <cstdint>
+#include <cstddef>
+
+static const uint32_t stateTag = 0x54533843;     // "C8ST" in native byte order
+static const uint32_t stateVersion = 3;
+
+/* The complete machine state as one flat record, so saving and
+ * restoring are a straight copy. The layout has no implicit padding,
+ * which keeps every byte defined for delta compression. A state file
+ * is this record as-is, native byte order. */
+struct chip8state {
+    uint32_t tag;
+    uint32_t version;
+    uint32_t cyclesPerFrame;
+    uint32_t frameCycle;
+    uint64_t rng;               // CXNN generator state
+    uint64_t cycleCount;        // instructions run since load
+    uint64_t romHash;           // contentHash of the loaded ROM
+    uint64_t display[32];
+    uint16_t stack[16];
+    uint16_t indexReg;
+    uint16_t programCount;
+    uint16_t stackPointer;
+    uint16_t flags;             // stateFaulted
+    uint8_t V[16];
+    uint8_t keypad[16];
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t variant;            // chip8variant; 0 (chip8) in older records
+    uint8_t reserved[5];
+    uint8_t memory[4096];
+};
+
+static_assert(sizeof(chip8state) == 4472, "chip8state must not contain padding");
+
+static const uint16_t stateFaulted = 1 << 0;
+
+/* true when the record was written by this version and its stack
+ * pointer is one the machine can reach (0-16). programCount and
+ * indexReg aren't checked: running off the end of memory or FX1E
+ * legitimately take them past 0xFFF, and every use masks them. */
+inline bool stateValid(const chip8state& s)
+{
+    return s.tag == stateTag && s.version == stateVersion && s.stackPointer <= 16;
+}
+
+bool writeState(const char*, const chip8state&);
+bool readState(const char*, chip8state&);
+
+#endif //CHIP8_CHIP8STATE_H
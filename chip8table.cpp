@@ -0,0 +1,79 @@
+#include "chip8table.h"
+#include <cstring>
+using namespace std;
+
+chip8table::chip8table(size_t entries)
+{
+    size_t count = 1;
+    while(count * ways < entries) count <<= 1;
+    buckets.resize(count);
+    mask = count - 1;
+    clear();
+}
+
+void chip8table::clear()
+{
+    memset(buckets.data(), 0, buckets.size() * sizeof(bucket));
+    used = 0;
+    evicted = 0;
+    turn = 0;
+}
+
+bool chip8table::find(uint64_t hash, uint64_t& value) const
+{
+    uint64_t key = stored(hash);
+    const bucket& b = buckets[key & mask];
+    for(int i = 0; i < ways; ++i) {
+        if(b.entries[i].hash == key) {
+            value = b.entries[i].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// the entry holding hash, or where it should go: the first empty way,
+// otherwise the next one in turn
+chip8table::entry* chip8table::slotFor(uint64_t hash, bool& found)
+{
+    bucket& b = buckets[hash & mask];
+    entry* empty = nullptr;
+    for(int i = 0; i < ways; ++i) {
+        if(b.entries[i].hash == hash) {
+            found = true;
+            return &b.entries[i];
+        }
+        if(!empty && b.entries[i].hash == 0) empty = &b.entries[i];
+    }
+
+    found = false;
+    if(empty) {
+        ++used;
+        return empty;
+    }
+    ++evicted;
+    return &b.entries[turn++ % ways];
+}
+
+void chip8table::insert(uint64_t hash, uint64_t value)
+{
+    uint64_t key = stored(hash);
+    bool found;
+    entry* e = slotFor(key, found);
+    e->hash = key;
+    e->value = value;
+}
+
+bool chip8table::visit(uint64_t hash, uint64_t& value)
+{
+    uint64_t key = stored(hash);
+    bool found;
+    entry* e = slotFor(key, found);
+    if(found) {
+        value = e->value;
+        return true;
+    }
+    e->hash = key;
+    e->value = value;
+    return false;
+}
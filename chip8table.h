@@ -0,0 +1,65 @@
+//
+// Transposition table keyed by chip8 state hashes.
+//
+
+#ifndef CHIP8_CHIP8TABLE_H
+#define CHIP8_CHIP8TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* A fixed-size table from chip8::stateHash values to a 64-bit value of
+ * the caller's choosing (a search score, the frame a state was first
+ * seen on), for deduplicating positions in search and spotting states
+ * that repeat. Nothing is allocated after construction.
+ *
+ * Entries sit in buckets of four, picked by the low bits of the hash;
+ * the whole hash is stored and compared, so a lookup is one cache line
+ * and a few word compares. When a bucket is full, inserting replaces
+ * its entries in turn, so the table keeps the most recent states and
+ * a miss only means "not seen lately", never a wrong hit (short of a
+ * 64-bit hash collision). */
+class chip8table {
+public:
+    /* room for at least this many entries, rounded up to a power of two */
+    explicit chip8table(size_t entries = 1 << 20);
+
+    /* the value stored for hash; false when it isn't in the table */
+    bool find(uint64_t hash, uint64_t& value) const;
+
+    /* store value for hash, replacing any value already there */
+    void insert(uint64_t hash, uint64_t value);
+
+    /* find, and insert value when the hash is absent: true with the
+     * stored value when the state was already in the table */
+    bool visit(uint64_t hash, uint64_t& value);
+
+    void clear();
+
+    size_t capacity() const { return buckets.size() * ways; }
+    size_t size() const { return used; }
+    unsigned long long evictions() const { return evicted; }
+
+private:
+    static const int ways = 4;
+
+    struct entry {
+        uint64_t hash;          // 0 = empty; a hash of 0 is stored as 1
+        uint64_t value;
+    };
+    struct alignas(64) bucket {
+        entry entries[ways];
+    };
+
+    static uint64_t stored(uint64_t hash) { return hash ? hash : 1; }
+    entry* slotFor(uint64_t hash, bool& found);
+
+    std::vector<bucket> buckets;
+    size_t mask;
+    size_t used;
+    unsigned long long evicted;
+    unsigned int turn;          // next way to replace in a full bucket
+};
+
+#endif //CHIP8_CHIP8TABLE_H
@@ -0,0 +1,158 @@
+#include "chip8thread.h"
+#include <chrono>
+#include <cstring>
+using namespace std;
+
+static int64_t now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+chip8thread::chip8thread(chip8& c8, chip8clock& clock, size_t inputCapacity)
+        : c8(c8), clock(clock), stopping(false),
+          inputHead(0), inputTail(0), lastInput(0),
+          back(0), front(1), middle(2), published(0),
+          latencyEvents(0), latencyTotal(0), latencyMax(0)
+{
+    size_t size = 1;
+    while(size < inputCapacity) size <<= 1;
+    inputs.resize(size);
+    inputMask = size - 1;
+
+    memset(frames, 0, sizeof(frames));
+    memset(shown, 0, sizeof(shown));
+}
+
+chip8thread::~chip8thread()
+{
+    stop();
+}
+
+void chip8thread::onStep(stepFunction f)
+{
+    step = f;
+}
+
+void chip8thread::onCommand(commandFunction f)
+{
+    handle = f;
+}
+
+void chip8thread::start()
+{
+    if(worker.joinable()) return;
+    stopping.store(false);
+    worker = thread(&chip8thread::run, this);
+}
+
+void chip8thread::stop()
+{
+    if(!worker.joinable()) return;
+    stopping.store(true);
+    worker.join();
+}
+
+bool chip8thread::pressKey(unsigned char key, bool down)
+{
+    input in;
+    in.isCommand = false;
+    in.key = key & 0xF;
+    in.down = down;
+    in.code = 0;
+    return post(in);
+}
+
+bool chip8thread::command(int code)
+{
+    input in;
+    in.isCommand = true;
+    in.key = 0;
+    in.down = false;
+    in.code = code;
+    return post(in);
+}
+
+bool chip8thread::post(const input& in)
+{
+    size_t tail = inputTail.load(memory_order_relaxed);
+    if(tail - inputHead.load(memory_order_acquire) > inputMask) return false;
+
+    inputs[tail & inputMask] = in;
+    inputs[tail & inputMask].posted = now();
+    inputTail.store(tail + 1, memory_order_release);
+    return true;
+}
+
+// emulation thread, between frames
+void chip8thread::applyInput()
+{
+    size_t head = inputHead.load(memory_order_relaxed);
+    size_t tail = inputTail.load(memory_order_acquire);
+    if(head == tail) return;
+
+    int64_t applied = now();
+    for(; head != tail; ++head) {
+        const input& in = inputs[head & inputMask];
+        if(in.isCommand) {
+            if(handle) handle(in.code);
+        }
+        else {
+            c8.keypad[in.key] = in.down ? 1 : 0;
+        }
+
+        long long waited = applied - in.posted;
+        latencyTotal.fetch_add(waited, memory_order_relaxed);
+        latencyEvents.fetch_add(1, memory_order_relaxed);
+        if(waited > latencyMax.load(memory_order_relaxed)) latencyMax.store(waited, memory_order_relaxed);
+        lastInput = in.posted;
+    }
+    inputHead.store(head, memory_order_release);
+}
+
+void chip8thread::publish()
+{
+    chip8frame& f = frames[back];
+    memcpy(f.display, c8.getDisplay(), sizeof(f.display));
+    f.number = ++published;
+    f.beeping = c8.isBeeping();
+    f.inputTime = lastInput;
+    lastInput = 0;                  // later frames without new input carry 0
+
+    back = middle.exchange(back | fresh, memory_order_acq_rel) & ~fresh;
+}
+
+const chip8frame* chip8thread::latest(uint32_t& rows)
+{
+    rows = 0;
+    if((middle.load(memory_order_acquire) & fresh) == 0) return nullptr;
+    front = middle.exchange(front, memory_order_acq_rel) & ~fresh;
+
+    const chip8frame& f = frames[front];
+    for(int y = 0; y < 32; ++y) {
+        if(f.display[y] != shown[y]) rows |= 1u << y;
+    }
+    memcpy(shown, f.display, sizeof(shown));
+    return &f;
+}
+
+inputLatency chip8thread::latency() const
+{
+    inputLatency l;
+    l.events = latencyEvents.load(memory_order_relaxed);
+    l.mean = l.events ? latencyTotal.load(memory_order_relaxed) / (long long)l.events : 0;
+    l.max = latencyMax.load(memory_order_relaxed);
+    return l;
+}
+
+void chip8thread::run()
+{
+    // the first frame, so the presentation thread has something to show
+    publish();
+
+    while(!stopping.load(memory_order_relaxed)) {
+        clock.sleepUntilDue();
+        applyInput();
+        bool changed = step ? step() : clock.runDue() > 0;
+        if(changed) publish();
+    }
+}
@@ -0,0 +1,128 @@
+//
+// Runs a chip8 on its own thread, exchanging frames and input with the
+// presentation thread without locks.
+//
+
+#ifndef CHIP8_CHIP8THREAD_H
+#define CHIP8_CHIP8THREAD_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "chip8clock.h"
+
+/* A published frame. inputTime is the steady_clock time (in
+ * nanoseconds) at which the newest input applied since the previous
+ * frame was posted, 0 when there was none, so presenting hosts can
+ * measure input to photon latency once per input. */
+struct chip8frame {
+    uint64_t display[32];
+    unsigned long long number;
+    bool beeping;
+    int64_t inputTime;
+};
+
+/* Time from posting input to the emulation thread applying it, in
+ * nanoseconds. In real-time mode the wait is bounded by one frame
+ * period plus the time to run a frame, since input is applied before
+ * every frame that runs. */
+struct inputLatency {
+    unsigned long long events;
+    long long mean;
+    long long max;
+};
+
+/* Moves emulation off the presentation thread. The emulation thread
+ * paces the instance with its chip8clock and, between frames, applies
+ * input posted by the presentation thread, so key changes land between
+ * instructions and never race a running frame. Frames go out through a
+ * triple buffer: the emulation thread never waits for the presentation
+ * thread to finish with a frame, and the presentation thread always
+ * gets the newest complete one, so vsync and slow uploads don't change
+ * the emulation rate.
+ *
+ * Input is a wait-free single-producer, single-consumer queue, so
+ * pressKey() and command() must all be called from one thread (the UI
+ * thread), as must latest(). While the thread runs, the instance, its
+ * clock and anything the step and command functions touch belong to
+ * the emulation thread. */
+class chip8thread {
+public:
+    /* Step: run whatever is due on the emulation thread (by default
+     * clock.runDue()) and return whether the display may have changed.
+     * Command: handle a host command posted with command(). Both are
+     * set before start(). */
+    typedef std::function<bool()> stepFunction;
+    typedef std::function<void(int)> commandFunction;
+
+    chip8thread(chip8&, chip8clock&, size_t inputCapacity = 256);
+    ~chip8thread();
+
+    void onStep(stepFunction);
+    void onCommand(commandFunction);
+
+    void start();
+    void stop();        // returns once the emulation thread has exited
+    bool isRunning() const { return worker.joinable(); }
+
+    /* queue a keypad change or a host command; false when the queue is
+     * full */
+    bool pressKey(unsigned char key, bool down);
+    bool command(int);
+
+    /* The newest frame, or null when none has been published since the
+     * last call. rows has a bit set for every row that differs from the
+     * frame returned before. The frame stays valid until the next call. */
+    const chip8frame* latest(uint32_t& rows);
+
+    /* readable from any thread */
+    inputLatency latency() const;
+
+private:
+    struct input {
+        bool isCommand;
+        unsigned char key;
+        bool down;
+        int code;
+        int64_t posted;
+    };
+
+    bool post(const input&);
+    void applyInput();
+    void publish();
+    void run();
+
+    chip8& c8;
+    chip8clock& clock;
+    stepFunction step;
+    commandFunction handle;
+    std::thread worker;
+    std::atomic<bool> stopping;
+
+    // input ring: the UI thread writes tail, the emulation thread head
+    std::vector<input> inputs;
+    size_t inputMask;
+    std::atomic<size_t> inputHead;
+    std::atomic<size_t> inputTail;
+    int64_t lastInput;
+
+    // triple buffer: the emulation thread owns back, the UI thread owns
+    // front, and they swap through middle, whose fresh bit says that it
+    // holds a frame the UI thread hasn't taken yet
+    static const unsigned int fresh = 4;
+    chip8frame frames[3];
+    unsigned int back;
+    unsigned int front;
+    std::atomic<unsigned int> middle;
+    unsigned long long published;
+    uint64_t shown[32];
+
+    std::atomic<unsigned long long> latencyEvents;
+    std::atomic<long long> latencyTotal;
+    std::atomic<long long> latencyMax;
+};
+
+#endif //CHIP8_CHIP8THREAD_H
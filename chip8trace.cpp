@@ -0,0 +1,34 @@
+#include "chip8trace.h"
+#include <cstring>
+
+bool chip8trace::dump(const char* path) const
+{
+    FILE* out = fopen(path, "wb");
+    if(!out) return false;
+
+    uint32_t count = (total < CHIP8_TRACE_RING_SIZE) ? static_cast<uint32_t>(total) : CHIP8_TRACE_RING_SIZE;
+    uint32_t first = (head - count) & (CHIP8_TRACE_RING_SIZE - 1);
+
+    traceHeader header;
+    memcpy(header.magic, "C8TR", 4);
+    header.version = traceVersion;
+    header.recordSize = sizeof(traceRecord);
+    header.count = count;
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    for(uint32_t i = 0; ok && i < count; ++i) {
+        ok = fwrite(&ring[(first + i) & (CHIP8_TRACE_RING_SIZE - 1)], sizeof(traceRecord), 1, out) == 1;
+    }
+
+    return fclose(out) == 0 && ok;
+}
+
+// PC=0x2A4 OP=8014 I=0x2EA V0=1F VF=00
+void chip8trace::print(FILE* out, const traceRecord& r)
+{
+    fprintf(out, "PC=0x%03X OP=%04X I=0x%03X", r.pc, r.opcode, r.indexReg);
+    for(int i = 0; i < 16; ++i) {
+        if(r.changed & (1 << i)) fprintf(out, " V%X=%02X", i, r.V[i]);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,89 @@
+//
+// Execution trace for the chip8 core.
+//
+
+#ifndef CHIP8_CHIP8TRACE_H
+#define CHIP8_CHIP8TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+
+/* Trace levels, chosen at compile time with -DCHIP8_TRACE_LEVEL=n:
+ *
+ *   0  release: no tracing code is compiled in at all
+ *   1  debug: every interpreted instruction appends a binary record
+ *      to an in-memory ring buffer, dumped on demand or on the first
+ *      unknown opcode
+ *   2  verbose: as 1, and each record is also printed to stderr
+ *
+ * The JIT is bypassed at levels above 0 so every instruction is
+ * recorded. */
+#ifndef CHIP8_TRACE_LEVEL
+#define CHIP8_TRACE_LEVEL 0
+#endif
+
+/* records kept in the ring buffer (power of two) */
+#ifndef CHIP8_TRACE_RING_SIZE
+#define CHIP8_TRACE_RING_SIZE 4096
+#endif
+
+/* One executed instruction: where it ran, what it was, the index
+ * register and the V registers after it ran. changed has bit n set
+ * when it modified Vn. */
+struct traceRecord {
+    uint16_t pc;
+    uint16_t opcode;
+    uint16_t indexReg;
+    uint16_t changed;
+    uint8_t V[16];
+};
+
+/* Dump file layout, native byte order:
+ *   char[4] "C8TR", uint32 version, uint32 record size, uint32 count,
+ *   then count records, oldest first */
+struct traceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t count;
+};
+
+static const uint32_t traceVersion = 1;
+
+class chip8trace {
+public:
+    chip8trace() : head(0), total(0) {}
+
+    void clear() { head = 0; total = 0; }
+
+    void record(uint16_t pc, uint16_t opcode, uint16_t indexReg,
+                const uint8_t* before, const uint8_t* after)
+    {
+        traceRecord& r = ring[head];
+        r.pc = pc;
+        r.opcode = opcode;
+        r.indexReg = indexReg;
+        r.changed = 0;
+        for(int i = 0; i < 16; ++i) {
+            r.V[i] = after[i];
+            r.changed |= (before[i] != after[i]) << i;
+        }
+#if CHIP8_TRACE_LEVEL >= 2
+        print(stderr, r);
+#endif
+        head = (head + 1) & (CHIP8_TRACE_RING_SIZE - 1);
+        ++total;
+    }
+
+    /* write the buffered records, oldest first */
+    bool dump(const char*) const;
+
+    static void print(FILE*, const traceRecord&);
+
+private:
+    traceRecord ring[CHIP8_TRACE_RING_SIZE];
+    uint32_t head;
+    uint64_t total;
+};
+
+#endif //CHIP8_CHIP8TRACE_H
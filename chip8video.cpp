@@ -0,0 +1,95 @@
+#include "chip8video.h"
+#include <iostream>
+using namespace std;
+
+chip8video::chip8video()
+        : out(nullptr), piped(false), failed(false), kind(y4m), width(0), height(0), frames(0)
+{
+}
+
+chip8video::~chip8video()
+{
+    close();
+}
+
+bool chip8video::open(const string& target, format f, const chip8framebuffer& screen, unsigned int fps)
+{
+    close();
+
+    piped = !target.empty() && target[0] == '|';
+    out = piped ? popen(target.c_str() + 1, "w") : fopen(target.c_str(), "wb");
+    if(!out) {
+        cerr << "Could not open " << (piped ? "pipe to " + target.substr(1) : target) << endl;
+        return false;
+    }
+
+    kind = f;
+    width = screen.width();
+    height = screen.height();
+    failed = false;
+    frames = 0;
+
+    if(kind == y4m) {
+        header = "FRAME\n";
+        planes.assign(width * height * 3, 0);
+        failed = fprintf(out, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n", width, height, fps ? fps : 60) < 0;
+    }
+    else {
+        header = "P6\n" + to_string(width) + " " + to_string(height) + "\n255\n";
+        planes.clear();
+    }
+    return !failed;
+}
+
+bool chip8video::write(const chip8framebuffer& screen, uint32_t rows)
+{
+    if(!out || failed) return false;
+
+    failed = fwrite(header.data(), 1, header.size(), out) != header.size();
+    if(kind == y4m) {
+        convertRows(screen, frames == 0 ? 0xFFFFFFFF : rows);
+        if(!failed) failed = fwrite(planes.data(), 1, planes.size(), out) != planes.size();
+    }
+    else {
+        size_t bytes = width * height * 3;
+        if(!failed) failed = fwrite(screen.pixels(), 1, bytes, out) != bytes;
+    }
+
+    ++frames;
+    return !failed;
+}
+
+// RGB to BT.601 limited-range YCbCr for the lines of the given display rows
+void chip8video::convertRows(const chip8framebuffer& screen, uint32_t rows)
+{
+    size_t planeSize = width * height;
+    unsigned int scale = screen.getScale();
+
+    for(int r = 0; r < 32; ++r) {
+        if((rows & (1u << r)) == 0) continue;
+
+        for(unsigned int line = r * scale; line < (r + 1) * scale; ++line) {
+            const unsigned char* rgb = screen.row(line);
+            unsigned char* y = &planes[line * width];
+            unsigned char* u = y + planeSize;
+            unsigned char* v = u + planeSize;
+            for(unsigned int x = 0; x < width; ++x, rgb += 3) {
+                int red = rgb[0], green = rgb[1], blue = rgb[2];
+                y[x] = ((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16;
+                u[x] = ((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128;
+                v[x] = ((112 * red - 94 * green - 18 * blue + 128) >> 8) + 128;
+            }
+        }
+    }
+}
+
+bool chip8video::close()
+{
+    if(!out) return true;
+
+    bool ok = !failed && fflush(out) == 0;
+    if(piped) ok = pclose(out) == 0 && ok;
+    else ok = fclose(out) == 0 && ok;
+    out = nullptr;
+    return ok;
+}
@@ -0,0 +1,60 @@
+//
+// Streaming video recorder for chip8 framebuffers.
+//
+
+#ifndef CHIP8_CHIP8VIDEO_H
+#define CHIP8_CHIP8VIDEO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "chip8frontend.h"
+
+/* Writes a chip8framebuffer out frame by frame, either to a file or,
+ * when the target starts with '|', to the standard input of a command
+ * (an external encoder such as "|ffmpeg -i - out.mp4").
+ *
+ *   y4m   YUV4MPEG2, 4:4:4, BT.601 limited range, at the given rate
+ *   ppm   back-to-back binary P6 images (ffmpeg: -f image2pipe)
+ *
+ * Everything a frame needs is allocated by open(). A PPM frame is
+ * written straight from the framebuffer; a Y4M frame converts only the
+ * rows it is told changed, into planes kept from the previous frame. */
+class chip8video {
+public:
+    enum format { y4m, ppm };
+
+    chip8video();
+    ~chip8video();
+
+    /* false with a message on stderr when the target can't be opened */
+    bool open(const std::string& target, format, const chip8framebuffer&, unsigned int fps = 60);
+
+    /* append one frame; rows are the display rows that changed since the
+     * previous frame (the first frame is always converted whole). False
+     * once a write has failed, such as when the encoder exits. */
+    bool write(const chip8framebuffer&, uint32_t rows = 0xFFFFFFFF);
+
+    /* flush and close; waits for a piped command to exit */
+    bool close();
+
+    bool isOpen() const { return out != nullptr; }
+    bool good() const { return out != nullptr && !failed; }
+    unsigned long long framesWritten() const { return frames; }
+
+private:
+    void convertRows(const chip8framebuffer&, uint32_t);
+
+    FILE* out;
+    bool piped;
+    bool failed;
+    format kind;
+    unsigned int width;
+    unsigned int height;
+    unsigned long long frames;
+    std::string header;                 // per-frame header: "FRAME\n" or the P6 header
+    std::vector<unsigned char> planes;  // Y, U and V for y4m
+};
+
+#endif //CHIP8_CHIP8VIDEO_H
@@ -0,0 +1,629 @@
+#include "chip8wide.h"
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/* Byte-lane vector primitives. Masks are 0xFF/0x00 per lane, as
+ * produced by veq; vandnot(a, b) is (~a & b). */
+#if defined(__AVX2__)
+typedef __m256i vec;
+static const size_t vecWidth = 32;
+static inline vec vload(const unsigned char* p)    { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+static inline void vstore(unsigned char* p, vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+static inline vec vsplat(unsigned char b)          { return _mm256_set1_epi8(static_cast<char>(b)); }
+static inline vec vadd(vec a, vec b)               { return _mm256_add_epi8(a, b); }
+static inline vec vsub(vec a, vec b)               { return _mm256_sub_epi8(a, b); }
+static inline vec vand(vec a, vec b)               { return _mm256_and_si256(a, b); }
+static inline vec vor(vec a, vec b)                { return _mm256_or_si256(a, b); }
+static inline vec vxor(vec a, vec b)               { return _mm256_xor_si256(a, b); }
+static inline vec vandnot(vec a, vec b)            { return _mm256_andnot_si256(a, b); }
+static inline vec vmin(vec a, vec b)               { return _mm256_min_epu8(a, b); }
+static inline vec vmax(vec a, vec b)               { return _mm256_max_epu8(a, b); }
+static inline vec veq(vec a, vec b)                { return _mm256_cmpeq_epi8(a, b); }
+static inline vec vshr1(vec a)                     { return vand(_mm256_srli_epi16(a, 1), vsplat(0x7F)); }
+static inline vec vblend(vec old, vec value, vec m){ return _mm256_blendv_epi8(old, value, m); }
+#elif defined(__SSE2__)
+typedef __m128i vec;
+static const size_t vecWidth = 16;
+static inline vec vload(const unsigned char* p)    { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+static inline void vstore(unsigned char* p, vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+static inline vec vsplat(unsigned char b)          { return _mm_set1_epi8(static_cast<char>(b)); }
+static inline vec vadd(vec a, vec b)               { return _mm_add_epi8(a, b); }
+static inline vec vsub(vec a, vec b)               { return _mm_sub_epi8(a, b); }
+static inline vec vand(vec a, vec b)               { return _mm_and_si128(a, b); }
+static inline vec vor(vec a, vec b)                { return _mm_or_si128(a, b); }
+static inline vec vxor(vec a, vec b)               { return _mm_xor_si128(a, b); }
+static inline vec vandnot(vec a, vec b)            { return _mm_andnot_si128(a, b); }
+static inline vec vmin(vec a, vec b)               { return _mm_min_epu8(a, b); }
+static inline vec vmax(vec a, vec b)               { return _mm_max_epu8(a, b); }
+static inline vec veq(vec a, vec b)                { return _mm_cmpeq_epi8(a, b); }
+static inline vec vshr1(vec a)                     { return vand(_mm_srli_epi16(a, 1), vsplat(0x7F)); }
+static inline vec vblend(vec old, vec value, vec m){ return vor(vand(m, value), vandnot(m, old)); }
+#else
+typedef unsigned char vec;
+static const size_t vecWidth = 1;
+static inline vec vload(const unsigned char* p)    { return *p; }
+static inline void vstore(unsigned char* p, vec v) { *p = v; }
+static inline vec vsplat(unsigned char b)          { return b; }
+static inline vec vadd(vec a, vec b)               { return a + b; }
+static inline vec vsub(vec a, vec b)               { return a - b; }
+static inline vec vand(vec a, vec b)               { return a & b; }
+static inline vec vor(vec a, vec b)                { return a | b; }
+static inline vec vxor(vec a, vec b)               { return a ^ b; }
+static inline vec vandnot(vec a, vec b)            { return ~a & b; }
+static inline vec vmin(vec a, vec b)               { return a < b ? a : b; }
+static inline vec vmax(vec a, vec b)               { return a > b ? a : b; }
+static inline vec veq(vec a, vec b)                { return a == b ? 0xFF : 0; }
+static inline vec vshr1(vec a)                     { return a >> 1; }
+static inline vec vblend(vec old, vec value, vec m){ return (m & value) | (~m & old); }
+#endif
+
+// dst = op(a, b) on the lanes selected by m, over size lanes
+template<typename Op>
+static void kernel(unsigned char* dst, const unsigned char* a, const unsigned char* b,
+                   const unsigned char* m, size_t size, Op op)
+{
+    for(size_t i = 0; i < size; i += vecWidth) {
+        vec result = op(vload(a + i), vload(b + i));
+        vstore(dst + i, vblend(vload(dst + i), result, vload(m + i)));
+    }
+}
+
+// the laneCount lanes of a group's list, starting at head
+template<typename F>
+static inline void forLanes(const size_t* next, size_t head, size_t laneCount, F f)
+{
+    for(size_t k = 0, i = head; k < laneCount; ++k, i = next[i]) f(i);
+}
+
+// ops the vector kernels implement
+static inline bool registerOp(unsigned char handler)
+{
+    return (handler >= h3XNN && handler <= h9XY0) || handler == hFX07 || handler == hFX15 || handler == hFX18;
+}
+
+// ops after which a group's lanes may no longer share a programCount
+static inline bool mayDiverge(unsigned char handler)
+{
+    switch(handler) {
+    case h00EE: case h2NNN: case h3XNN: case h4XNN: case h5XY0: case h9XY0:
+    case hBNNN: case hEX9E: case hEXA1: case hFX0A: case hDecode:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// a group takes the vector kernels when it holds at least 1/vectorShare
+// of the lanes; below that, masking every vector chunk costs more than
+// running the group's lanes one by one
+static const size_t vectorShare = (vecWidth > 1) ? 8 : 0;
+
+chip8wide::chip8wide(size_t lanes)
+        : count(lanes),
+          stride((lanes + 31) & ~static_cast<size_t>(31)),
+          quirks(flagsOf<chip8Quirks>()),
+          V(16 * stride), indexReg(stride), programCount(stride),
+          delay_timer(stride), sound_timer(stride),
+          stack(16 * stride), stackPointer(stride), keypad(16 * stride),
+          seeds(lanes, 0), rng(lanes, seedRandom(0)),
+          memory(lanes * 4096), display(lanes * 32),
+          next(lanes), slot(0x10000, -1),
+          mask(stride), scratch(stride), allMask(stride)
+{
+    for(size_t i = 0; i < lanes; ++i) allMask[i] = 0xFF;
+    groups.reserve(lanes);
+    merged.reserve(lanes);
+}
+
+template<class Quirks>
+chip8wide::quirkFlags chip8wide::flagsOf()
+{
+    quirkFlags q = { Quirks::shiftVY, Quirks::indexAdvances, Quirks::jumpVX, Quirks::logicResetsVF, Quirks::clipSprites };
+    return q;
+}
+
+void chip8wide::setVariant(chip8variant v)
+{
+    switch(v) {
+    case variantCosmac: quirks = flagsOf<cosmacQuirks>(); break;
+    case variantSchipQuirks:  quirks = flagsOf<schipQuirks>(); break;
+    case variantXochipQuirks: quirks = flagsOf<xochipQuirks>(); break;
+    default:
+        v = variantChip8;
+        quirks = flagsOf<chip8Quirks>();
+    }
+    variant = v;
+}
+
+bool chip8wide::loadGame(std::string filename)
+{
+    // load once through the scalar core, then clone its memory into every lane
+    unique_ptr<chip8> image(new chip8());
+    if(!image->loadGame(filename)) return false;
+
+    for(size_t lane = 0; lane < count; ++lane) {
+        memcpy(&memory[lane * 4096], image->memory, 4096);
+    }
+
+    fill(V.begin(), V.end(), 0);
+    fill(indexReg.begin(), indexReg.end(), 0);
+    fill(programCount.begin(), programCount.end(), 0x200);
+    fill(delay_timer.begin(), delay_timer.end(), 0);
+    fill(sound_timer.begin(), sound_timer.end(), 0);
+    fill(stack.begin(), stack.end(), 0);
+    fill(stackPointer.begin(), stackPointer.end(), 0);
+    fill(keypad.begin(), keypad.end(), 0);
+    fill(display.begin(), display.end(), 0);
+    for(size_t lane = 0; lane < count; ++lane) rng[lane] = seedRandom(seeds[lane]);
+    frameCycle = 0;
+
+    for(int i = 0; i < 4096; ++i) {
+        decoded[i].handler = hDecode;
+        written[i] = false;
+    }
+
+    // every lane starts in one group at 0x200
+    for(size_t lane = 0; lane < count; ++lane) next[lane] = lane + 1;
+    groups.clear();
+    if(count > 0) {
+        group all = { 0x200, false, 0, count - 1, count };
+        groups.push_back(all);
+    }
+    return true;
+}
+
+void chip8wide::runCycles(unsigned long cycles)
+{
+    while(cycles-- > 0) cycle();
+}
+
+void chip8wide::cycle()
+{
+    const size_t* link = next.data();
+
+    for(auto& g : groups) {
+        unsigned short a = g.pc & 0xFFF, b = (g.pc + 1) & 0xFFF;
+        unsigned char handler = hDecode;
+
+        if(!written[a] && !written[b]) {
+            // every lane still holds the ROM's bytes here
+            instruction& in = decoded[a];
+            if(in.handler == hDecode) {
+                in = chip8::predecode(memory[a] << 8 | memory[b]);
+            }
+            step(in, g.head, g.size);
+            handler = in.handler;
+        }
+        else {
+            // some lane wrote over this address; decode per lane
+            forLanes(link, g.head, g.size, [&](size_t i) {
+                step(chip8::predecode(memory[i * 4096 + a] << 8 | memory[i * 4096 + b]), i, 1);
+            });
+        }
+
+        g.pc = programCount[g.head];
+        g.split = false;
+        if(mayDiverge(handler)) {
+            forLanes(link, g.head, g.size, [&](size_t i) { g.split |= (programCount[i] != g.pc); });
+        }
+    }
+
+    regroup();
+    advanceClock();
+}
+
+// Rebuild the group list for the next cycle: groups that stayed together
+// move as a whole, appended to any group already at the same programCount,
+// and only the lanes of groups that split are sorted out one by one.
+void chip8wide::regroup()
+{
+    merged.clear();
+    for(auto& g : groups) {
+        if(!g.split) {
+            join(g.pc, g.head, g.tail, g.size);
+            continue;
+        }
+        for(size_t k = 0, i = g.head; k < g.size; ++k) {
+            size_t following = next[i];
+            join(programCount[i], i, i, 1);
+            i = following;
+        }
+    }
+
+    for(auto& g : merged) slot[g.pc] = -1;
+    groups.swap(merged);
+}
+
+// append the list head..tail to the next cycle's group at pc
+inline void chip8wide::join(unsigned short pc, size_t head, size_t tail, size_t size)
+{
+    int& s = slot[pc];
+    if(s < 0) {
+        s = static_cast<int>(merged.size());
+        group fresh = { pc, false, head, tail, size };
+        merged.push_back(fresh);
+        return;
+    }
+    group& g = merged[s];
+    next[g.tail] = head;
+    g.tail = tail;
+    g.size += size;
+}
+
+// every lane runs one instruction per cycle, so they all share one frame counter
+void chip8wide::advanceClock()
+{
+    if(++frameCycle >= cyclesPerFrame) {
+        frameCycle = 0;
+        updateTimers();
+    }
+}
+
+void chip8wide::setCyclesPerFrame(unsigned int cycles)
+{
+    cyclesPerFrame = (cycles > 0) ? cycles : 1;
+    if(frameCycle >= cyclesPerFrame) frameCycle = 0;
+}
+
+void chip8wide::updateTimers()
+{
+    for(size_t i = 0; i < stride; ++i) {
+        delay_timer[i] -= (delay_timer[i] > 0);
+        sound_timer[i] -= (sound_timer[i] > 0);
+    }
+}
+
+void chip8wide::step(const instruction& in, size_t head, size_t laneCount)
+{
+    if(registerOp(in.handler)) {
+        bool shiftQuirk = quirks.shiftVY && (in.handler == h8XY6 || in.handler == h8XYE);
+        if(vectorShare && laneCount * vectorShare >= count && !shiftQuirk) stepVector(in, head, laneCount);
+        else stepLanes(in, head, laneCount);
+        return;
+    }
+
+    unsigned char* vx = reg(in.x);
+    unsigned char* vy = reg(in.y);
+    unsigned char* vf = reg(0xF);
+    unsigned short* pc = programCount.data();
+    const size_t* link = next.data();
+    const quirkFlags q = quirks;
+
+    switch(in.handler) {
+    case h00E0:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            memset(&display[i * 32], 0, 32 * sizeof(uint64_t));
+            pc[i] += 2;
+        });
+        break;
+
+    case h00EE:
+        // an empty stack stalls the lane, as a scalar chip8 faults
+        forLanes(link, head, laneCount, [&](size_t i) {
+            if(stackPointer[i] == 0) return;
+            --stackPointer[i];
+            pc[i] = stack[stackPointer[i] * stride + i] + 2;
+        });
+        break;
+
+    case h1NNN:
+        forLanes(link, head, laneCount, [&](size_t i) { pc[i] = in.nnn; });
+        break;
+
+    case h2NNN:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            if(stackPointer[i] >= 16) return;
+            stack[stackPointer[i] * stride + i] = pc[i];
+            ++stackPointer[i];
+            pc[i] = in.nnn;
+        });
+        break;
+
+    case hANNN:
+        forLanes(link, head, laneCount, [&](size_t i) { indexReg[i] = in.nnn; pc[i] += 2; });
+        break;
+
+    case hBNNN:
+    {
+        const unsigned char* offset = q.jumpVX ? vx : reg(0);
+        forLanes(link, head, laneCount, [&](size_t i) { pc[i] = in.nnn + offset[i]; });
+    }
+        break;
+
+    case hCXNN:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            vx[i] = nextRandom(rng[i]) & in.nn;
+            pc[i] += 2;
+        });
+        break;
+
+    case hDXYN:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            uint64_t* rows = &display[i * 32];
+            const unsigned char* mem = &memory[i * 4096];
+            unsigned int x = vx[i] & 63;
+            unsigned int y = vy[i] & 31;
+            unsigned int height = in.nn & 0x000F;
+            uint64_t collision = 0;
+
+            if(q.clipSprites && y + height > 32) height = 32 - y;
+            for(unsigned int yline = 0; yline < height; yline++) {
+                unsigned char bits = mem[(indexReg[i] + yline) & 0xFFF];
+                uint64_t sprite = q.clipSprites ? (static_cast<uint64_t>(bits) << 56) >> x : spriteRow(bits, x);
+                uint64_t& row = rows[(y + yline) & 31];
+                collision |= row & sprite;
+                row ^= sprite;
+            }
+            vf[i] = (collision != 0) ? 1 : 0;
+            pc[i] += 2;
+        });
+        break;
+
+    case hEX9E:
+    case hEXA1:
+    {
+        const bool ifPressed = (in.handler == hEX9E);
+        forLanes(link, head, laneCount, [&](size_t i) {
+            bool pressed = keypad[(vx[i] & 0xF) * stride + i] != 0;
+            pc[i] += (pressed == ifPressed) ? 4 : 2;
+        });
+    }
+        break;
+
+    case hFX0A:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            bool keyPress = false;
+            for(int key = 0; key < 16; ++key) {
+                if(keypad[key * stride + i] != 0) {
+                    vx[i] = key;
+                    keyPress = true;
+                }
+            }
+            if(keyPress) pc[i] += 2;
+        });
+        break;
+
+    case hFX1E:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            vf[i] = (indexReg[i] + vx[i] > 0xFFF) ? 1 : 0;
+            indexReg[i] += vx[i];
+            pc[i] += 2;
+        });
+        break;
+
+    case hFX29:
+        forLanes(link, head, laneCount, [&](size_t i) { indexReg[i] = vx[i] * 0x5; pc[i] += 2; });
+        break;
+
+    case hFX33:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            unsigned char* mem = &memory[i * 4096];
+            unsigned char value = vx[i];
+            mem[indexReg[i] & 0xFFF]       = value / 100;
+            mem[(indexReg[i] + 1) & 0xFFF] = (value / 10) % 10;
+            mem[(indexReg[i] + 2) & 0xFFF] = (value % 100) % 10;
+            for(int n = 0; n < 3; ++n) written[(indexReg[i] + n) & 0xFFF] = true;
+            pc[i] += 2;
+        });
+        break;
+
+    case hFX55:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            unsigned char* mem = &memory[i * 4096];
+            for(int r = 0; r <= in.x; ++r) {
+                mem[(indexReg[i] + r) & 0xFFF] = V[r * stride + i];
+                written[(indexReg[i] + r) & 0xFFF] = true;
+            }
+            if(q.indexAdvances) indexReg[i] += in.x + 1;
+            pc[i] += 2;
+        });
+        break;
+
+    case hFX65:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            const unsigned char* mem = &memory[i * 4096];
+            for(int r = 0; r <= in.x; ++r) {
+                V[r * stride + i] = mem[(indexReg[i] + r) & 0xFFF];
+            }
+            if(q.indexAdvances) indexReg[i] += in.x + 1;
+            pc[i] += 2;
+        });
+        break;
+
+    default:
+        // unknown opcodes stall, as in the scalar core
+        break;
+    }
+}
+
+// register ops for a large group: one masked kernel pass over all lanes
+void chip8wide::stepVector(const instruction& in, size_t head, size_t laneCount)
+{
+    unsigned char* vx = reg(in.x);
+    unsigned char* vy = reg(in.y);
+    unsigned char* vf = reg(0xF);
+    unsigned short* pc = programCount.data();
+    const size_t* link = next.data();
+    const vec one = vsplat(1);
+
+    const bool all = (laneCount == count);
+    unsigned char* m = all ? allMask.data() : mask.data();
+    if(!all) forLanes(link, head, laneCount, [m](size_t i) { m[i] = 0xFF; });
+
+    // skip ops set 0xFF in skip[] for lanes that skip the next instruction
+    unsigned char* skip = scratch.data();
+    bool skips = false;
+
+    switch(in.handler) {
+    case h3XNN:
+    case h4XNN:
+    case h5XY0:
+    case h9XY0:
+    {
+        const vec nn = vsplat(in.nn);
+        switch(in.handler) {
+        case h3XNN: kernel(skip, vx, vy, m, stride, [nn](vec a, vec)  { return veq(a, nn); }); break;
+        case h4XNN: kernel(skip, vx, vy, m, stride, [nn](vec a, vec)  { return vandnot(veq(a, nn), vsplat(0xFF)); }); break;
+        case h5XY0: kernel(skip, vx, vy, m, stride, [](vec a, vec b)  { return veq(a, b); }); break;
+        default:    kernel(skip, vx, vy, m, stride, [](vec a, vec b)  { return vandnot(veq(a, b), vsplat(0xFF)); }); break;
+        }
+        skips = true;
+    }
+        break;
+
+    case h6XNN:
+    {
+        const vec nn = vsplat(in.nn);
+        kernel(vx, vx, vx, m, stride, [nn](vec, vec) { return nn; });
+    }
+        break;
+
+    case h7XNN:
+    {
+        const vec nn = vsplat(in.nn);
+        kernel(vx, vx, vx, m, stride, [nn](vec a, vec) { return vadd(a, nn); });
+    }
+        break;
+
+    case h8XY0: kernel(vx, vx, vy, m, stride, [](vec, vec b)   { return b; }); break;
+    case h8XY1: kernel(vx, vx, vy, m, stride, [](vec a, vec b) { return vor(a, b); }); break;
+    case h8XY2: kernel(vx, vx, vy, m, stride, [](vec a, vec b) { return vand(a, b); }); break;
+    case h8XY3: kernel(vx, vx, vy, m, stride, [](vec a, vec b) { return vxor(a, b); }); break;
+
+    // flag ops write VF first, then recompute VX from the updated registers,
+    // matching the scalar order when X or Y is F
+    case h8XY4:
+        kernel(vf, vx, vy, m, stride, [one](vec a, vec b) { return vandnot(veq(vmin(vadd(a, b), a), a), one); });
+        kernel(vx, vx, vy, m, stride, [](vec a, vec b) { return vadd(a, b); });
+        break;
+
+    case h8XY5:
+        kernel(vf, vx, vy, m, stride, [one](vec a, vec b) { return vand(veq(vmax(a, b), a), one); });
+        kernel(vx, vx, vy, m, stride, [](vec a, vec b) { return vsub(a, b); });
+        break;
+
+    case h8XY6:
+        kernel(vf, vx, vy, m, stride, [one](vec a, vec) { return vand(a, one); });
+        kernel(vx, vx, vy, m, stride, [](vec a, vec) { return vshr1(a); });
+        break;
+
+    case h8XY7:
+        kernel(vf, vx, vy, m, stride, [one](vec a, vec b) { return vand(veq(vmax(a, b), b), one); });
+        kernel(vx, vx, vy, m, stride, [](vec a, vec b) { return vsub(b, a); });
+        break;
+
+    case h8XYE:
+    {
+        const vec high = vsplat(0x80);
+        kernel(vf, vx, vy, m, stride, [one, high](vec a, vec) { return vand(veq(vand(a, high), high), one); });
+        kernel(vx, vx, vy, m, stride, [](vec a, vec) { return vadd(a, a); });
+    }
+        break;
+
+    case hFX07: kernel(vx, vx, delay_timer.data(), m, stride, [](vec, vec b) { return b; }); break;
+    case hFX15: kernel(delay_timer.data(), vx, vx, m, stride, [](vec a, vec) { return a; }); break;
+    case hFX18: kernel(sound_timer.data(), vx, vx, m, stride, [](vec a, vec) { return a; }); break;
+    }
+
+    if(quirks.logicResetsVF && in.handler >= h8XY1 && in.handler <= h8XY3) {
+        kernel(vf, vf, vf, m, stride, [](vec, vec) { return vsplat(0); });
+    }
+
+    if(skips) forLanes(link, head, laneCount, [&](size_t i) { pc[i] += 2 + (skip[i] & 2); });
+    else forLanes(link, head, laneCount, [pc](size_t i) { pc[i] += 2; });
+
+    if(!all) forLanes(link, head, laneCount, [m](size_t i) { m[i] = 0; });
+}
+
+// register ops for a small group, lane by lane
+void chip8wide::stepLanes(const instruction& in, size_t head, size_t laneCount)
+{
+    unsigned char* vx = reg(in.x);
+    unsigned char* vy = reg(in.y);
+    unsigned char* vf = reg(0xF);
+    unsigned short* pc = programCount.data();
+    const size_t* link = next.data();
+    const unsigned char nn = in.nn;
+    const bool resetVF = quirks.logicResetsVF;
+
+    switch(in.handler) {
+    case h3XNN: forLanes(link, head, laneCount, [&](size_t i) { pc[i] += (vx[i] == nn) ? 4 : 2; }); return;
+    case h4XNN: forLanes(link, head, laneCount, [&](size_t i) { pc[i] += (vx[i] != nn) ? 4 : 2; }); return;
+    case h5XY0: forLanes(link, head, laneCount, [&](size_t i) { pc[i] += (vx[i] == vy[i]) ? 4 : 2; }); return;
+    case h9XY0: forLanes(link, head, laneCount, [&](size_t i) { pc[i] += (vx[i] != vy[i]) ? 4 : 2; }); return;
+
+    case h6XNN: forLanes(link, head, laneCount, [&](size_t i) { vx[i] = nn; }); break;
+    case h7XNN: forLanes(link, head, laneCount, [&](size_t i) { vx[i] += nn; }); break;
+    case h8XY0: forLanes(link, head, laneCount, [&](size_t i) { vx[i] = vy[i]; }); break;
+    case h8XY1: forLanes(link, head, laneCount, [&](size_t i) { vx[i] |= vy[i]; if(resetVF) vf[i] = 0; }); break;
+    case h8XY2: forLanes(link, head, laneCount, [&](size_t i) { vx[i] &= vy[i]; if(resetVF) vf[i] = 0; }); break;
+    case h8XY3: forLanes(link, head, laneCount, [&](size_t i) { vx[i] ^= vy[i]; if(resetVF) vf[i] = 0; }); break;
+
+    case h8XY4:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            vf[i] = (vy[i] > (0xFF - vx[i])) ? 1 : 0;
+            vx[i] += vy[i];
+        });
+        break;
+
+    case h8XY5:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            vf[i] = (vy[i] > vx[i]) ? 0 : 1;
+            vx[i] -= vy[i];
+        });
+        break;
+
+    case h8XY7:
+        forLanes(link, head, laneCount, [&](size_t i) {
+            vf[i] = (vx[i] > vy[i]) ? 0 : 1;
+            vx[i] = vy[i] - vx[i];
+        });
+        break;
+
+    case h8XY6:
+        if(quirks.shiftVY) {
+            forLanes(link, head, laneCount, [&](size_t i) {
+                unsigned char value = vy[i];
+                vx[i] = value >> 1;
+                vf[i] = value & 0x1;
+            });
+        }
+        else {
+            forLanes(link, head, laneCount, [&](size_t i) {
+                vf[i] = vx[i] & 0x1;
+                vx[i] >>= 1;
+            });
+        }
+        break;
+
+    case h8XYE:
+        if(quirks.shiftVY) {
+            forLanes(link, head, laneCount, [&](size_t i) {
+                unsigned char value = vy[i];
+                vx[i] = value << 1;
+                vf[i] = value >> 7;
+            });
+        }
+        else {
+            forLanes(link, head, laneCount, [&](size_t i) {
+                vf[i] = vx[i] >> 7;
+                vx[i] <<= 1;
+            });
+        }
+        break;
+
+    case hFX07: forLanes(link, head, laneCount, [&](size_t i) { vx[i] = delay_timer[i]; }); break;
+    case hFX15: forLanes(link, head, laneCount, [&](size_t i) { delay_timer[i] = vx[i]; }); break;
+    case hFX18: forLanes(link, head, laneCount, [&](size_t i) { sound_timer[i] = vx[i]; }); break;
+    }
+
+    forLanes(link, head, laneCount, [pc](size_t i) { pc[i] += 2; });
+}
@@ -0,0 +1,134 @@
+//
+// Lockstep engine that steps many chip8 instances of the same ROM
+// together, with the machine state stored as structure-of-arrays.
+//
+
+#ifndef CHIP8_CHIP8WIDE_H
+#define CHIP8_CHIP8WIDE_H
+
+#include <string>
+#include <vector>
+#include "chip8.h"
+
+/* Every instance ("lane") executes exactly one instruction per cycle,
+ * just like a scalar chip8 would. Lanes are kept in groups that share a
+ * programCount; a group decodes and dispatches its instruction once for
+ * all of its lanes. Groups persist from cycle to cycle: lanes that branch
+ * differently split off, and groups whose programCounts meet merge, so
+ * lanes are only regrouped on the cycles where that happens. Register
+ * arithmetic for large groups runs as SSE2/AVX2 kernels over the
+ * per-register lane arrays; small groups run it lane by lane.
+ *
+ * Memory, stack and display stay per lane, since they are indexed
+ * by lane-dependent addresses.
+ *
+ * Quirks follow setVariant as in the scalar core; an empty-stack 00EE
+ * or a 17th nested call stalls the lane where a chip8 would fault.
+ *
+ * This is not a general fast path. Throughput depends on how far lanes
+ * diverge: with each lane on its own seed and input, PONG and TETRIS
+ * split 256 lanes into about 40 groups per cycle, and scalar instances
+ * (which also skip idle loops) are faster below a few hundred lanes.
+ * `bench <rom> [lanes]` measures both on a given ROM. */
+class chip8wide {
+public:
+    explicit chip8wide(size_t);
+    ~chip8wide(){}
+
+    bool loadGame(std::string);
+    void runCycles(unsigned long);
+
+    size_t lanes() const { return count; }
+    void setCyclesPerFrame(unsigned int);
+
+    /* interpreter variant for every lane (see chip8quirks.h), chip8 by
+     * default; takes effect at the next cycle */
+    void setVariant(chip8variant);
+    chip8variant getVariant() const { return variant; }
+
+    /* CXNN seed per lane, as chip8::seed; lanes default to 0 like a
+     * scalar chip8, and loadGame restarts every lane from its seed */
+    void seed(size_t lane, uint64_t value) { seeds[lane] = value; rng[lane] = seedRandom(value); }
+
+    /* per-lane keypad and state */
+    void setKey(size_t lane, int key, bool down) { keypad[key * stride + lane] = down ? 1 : 0; }
+    unsigned char getV(size_t lane, int reg) const { return V[reg * stride + lane]; }
+    unsigned short getIndexReg(size_t lane) const { return indexReg[lane]; }
+    unsigned short getProgramCount(size_t lane) const { return programCount[lane]; }
+    unsigned char getDelayTimer(size_t lane) const { return delay_timer[lane]; }
+    const uint64_t* getDisplay(size_t lane) const { return &display[lane * 32]; }
+    const unsigned char* getMemory(size_t lane) const { return &memory[lane * 4096]; }
+
+private:
+    /* size lanes that share programCount pc, linked through next[]
+     * from head to tail; split is set when a branch sent them apart */
+    struct group {
+        unsigned short pc;
+        bool split;
+        size_t head;
+        size_t tail;
+        size_t size;
+    };
+
+    /* the variant's quirks, checked once per group rather than per lane */
+    struct quirkFlags {
+        bool shiftVY, indexAdvances, jumpVX, logicResetsVF, clipSprites;
+    };
+    template<class Quirks> static quirkFlags flagsOf();
+
+    void cycle();
+    void regroup();
+    void join(unsigned short, size_t, size_t, size_t);
+    void step(const instruction&, size_t, size_t);
+    void stepVector(const instruction&, size_t, size_t);
+    void stepLanes(const instruction&, size_t, size_t);
+    void advanceClock();
+    void updateTimers();
+
+    unsigned char* reg(int r) { return &V[r * stride]; }
+
+    size_t count;       // active lanes
+    size_t stride;      // lanes rounded up to the vector width
+
+    unsigned int cyclesPerFrame = chip8::defaultCyclesPerFrame;
+    unsigned int frameCycle = 0;
+
+    chip8variant variant = variantChip8;
+    quirkFlags quirks;
+
+    /* register file: V[r * stride + lane], and so on */
+    std::vector<unsigned char> V;
+    std::vector<unsigned short> indexReg;
+    std::vector<unsigned short> programCount;
+    std::vector<unsigned char> delay_timer;
+    std::vector<unsigned char> sound_timer;
+    std::vector<unsigned short> stack;
+    std::vector<unsigned short> stackPointer;
+    std::vector<unsigned char> keypad;
+    std::vector<uint64_t> seeds;
+    std::vector<uint64_t> rng;
+
+    /* per-lane blocks: memory[lane * 4096 + addr], display[lane * 32 + row] */
+    std::vector<unsigned char> memory;
+    std::vector<uint64_t> display;
+
+    /* decoded instructions are shared by all lanes until some lane
+     * writes over the bytes they came from */
+    instruction decoded[4096];
+    bool written[4096];
+
+    /* grouping: next links each group's lanes; regrouping builds the
+     * next cycle's groups in merged */
+    std::vector<size_t> next;
+    std::vector<group> groups;
+    std::vector<group> merged;
+    std::vector<int> slot;          // programCount -> merged group, -1 when unused
+
+    /* vector kernels: mask is 0xFF for the lanes of the group being
+     * stepped, allMask for every lane */
+    std::vector<unsigned char> mask;
+    std::vector<unsigned char> scratch;
+    std::vector<unsigned char> allMask;
+};
+
+#endif //CHIP8_CHIP8WIDE_H
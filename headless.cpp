@@ -0,0 +1,145 @@
+//
+// Headless frontend: runs a ROM with no windowing system, optionally
+// driven by an input movie, and records the display as video.
+//
+// usage: headless [--frames n] [--scale s] [--movie m] [--record target] [--ppm] [--jit] [--variant name] [--debug port] [--publish name] <rom>
+//
+// The record target is a file, or "|command" to pipe the frames to an
+// encoder. Frames are run back to back, as fast as the host allows;
+// each one becomes one video frame at 60 fps. Prints the frames run,
+// the time taken and the final framebuffer hash. With --debug, a
+// debugger listens on the port (see chip8debug.h) and the run waits
+// while it is paused. With --publish, every frame is also exported to
+// shared memory under the name (see chip8shm.h, and c8tail).
+//
+
+#include <iostream>
+#include <memory>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "chip8.h"
+#include "chip8movie.h"
+#include "chip8frontend.h"
+#include "chip8video.h"
+#include "chip8debug.h"
+#include "chip8shm.h"
+using namespace std;
+
+int main(int argc, char **argv)
+{
+    unsigned long frames = 600;
+    unsigned int scale = 1;
+    bool useJit = false;
+    chip8variant variant = variantChip8;
+    chip8video::format format = chip8video::y4m;
+    const char* moviePath = nullptr;
+    const char* target = nullptr;
+    const char* rom = nullptr;
+    int debugPort = 0;
+    const char* publishName = nullptr;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--scale") == 0 && i + 1 < argc) scale = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--movie") == 0 && i + 1 < argc) moviePath = argv[++i];
+        else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) target = argv[++i];
+        else if(strcmp(argv[i], "--ppm") == 0) format = chip8video::ppm;
+        else if(strcmp(argv[i], "--jit") == 0) useJit = true;
+        else if(strcmp(argv[i], "--debug") == 0 && i + 1 < argc) debugPort = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--publish") == 0 && i + 1 < argc) publishName = argv[++i];
+        else if(strcmp(argv[i], "--variant") == 0 && i + 1 < argc) {
+            if(!variantFromName(argv[++i], variant)) {
+                cerr << "Unknown variant " << argv[i] << endl;
+                return 2;
+            }
+        }
+        else rom = argv[i];
+    }
+    if(!rom) {
+        cerr << "usage: " << argv[0] << " [--frames n] [--scale s] [--movie m] [--record target] [--ppm] [--jit] [--variant name] [--debug port] [--publish name] <rom>" << endl;
+        return 2;
+    }
+
+    unique_ptr<chip8> c8(new chip8());
+    if(!c8->loadGame(rom)) return 2;
+    c8->enableJit(useJit);
+    c8->setVariant(variant);
+
+    chip8movie movie;
+    if(moviePath) {
+        if(!movie.load(moviePath)) {
+            cerr << "Could not read movie " << moviePath << endl;
+            return 2;
+        }
+        if(movie.romHash != c8->getRomHash()) {
+            cerr << rom << " is not the ROM " << moviePath << " was recorded on" << endl;
+            return 2;
+        }
+        c8->seed(movie.seed);
+        c8->setCyclesPerFrame(movie.cyclesPerFrame);
+        c8->setVariant(movie.variant);
+    }
+
+    chip8headless screen(scale);
+    chip8video video;
+    if(target) {
+        // a failed encoder shows up as a write error, not a signal
+        if(target[0] == '|') signal(SIGPIPE, SIG_IGN);
+        if(!video.open(target, format, screen.framebuffer())) return 2;
+        screen.attach(&video);
+    }
+
+    unique_ptr<chip8debug> debugger;
+    if(debugPort) {
+        debugger.reset(new chip8debug(*c8));
+        if(!debugger->listen(debugPort)) return 2;
+    }
+
+    chip8publisher publisher;
+    if(publishName && !publisher.create(publishName)) return 2;
+
+    auto start = chrono::steady_clock::now();
+    size_t event = 0;
+    for(unsigned long f = 0; f < frames; ++f) {
+        // run the frame in pieces, applying movie input at its exact cycle
+        uint64_t cycle = c8->getCycleCount();
+        uint64_t end = cycle + c8->getCyclesPerFrame();
+        while(cycle < end) {
+            if(debugger) {
+                debugger->poll();
+                while(debugger->paused()) debugger->poll(-1);
+                cycle = c8->getCycleCount();    // stepping moves it on
+                if(cycle >= end) break;
+            }
+            while(event < movie.events.size() && movie.events[event].cycle <= cycle) {
+                for(int k = 0; k < 16; ++k) c8->keypad[k] = (movie.events[event].keys >> k) & 1;
+                ++event;
+            }
+            uint64_t stop = end;
+            if(event < movie.events.size()) stop = min(stop, movie.events[event].cycle);
+            c8->runCycles(static_cast<unsigned long>(stop - cycle));
+            cycle = c8->getCycleCount();     // short of stop when the debugger stopped the run
+        }
+
+        screen.present(*c8, c8->damagedRows());
+        c8->acknowledgeDamage();
+        if(publishName) publisher.publish(*c8);
+        if(target && !video.good()) break;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    bool recorded = !target || video.close();
+    if(!recorded) cerr << "Could not write all frames to " << target << endl;
+
+    // FNV-1a of the rendered framebuffer
+    const chip8framebuffer& fb = screen.framebuffer();
+    uint64_t hash = contentHash(fb.pixels(), fb.width() * fb.height() * 3);
+    printf("%llu frames, %.3f s (%.0f fps), framebuffer %016llx\n",
+           screen.framesPresented(), seconds, seconds > 0 ? screen.framesPresented() / seconds : 0,
+           (unsigned long long)hash);
+
+    return recorded ? 0 : 1;
+}
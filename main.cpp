@@ -1,9 +1,24 @@
 #include <iostream>
-#include <OPENGL/gl.h>
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
 #include <GLUT/glut.h>
+#else
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <GL/glut.h>
+#endif
 #include "chip8.h"
+#include "chip8clock.h"
+#include "chip8frontend.h"
+#include "chip8thread.h"
+#include "chip8rewind.h"
+#include "chip8movie.h"
+#include "chip8debug.h"
+#include "chip8shm.h"
+#include <memory>
+#include <cstdlib>
+#include <cstring>
 
-#define PATH "/Users/isaacroberts/ClionProjects/chip8/c8games/PONG"
 using namespace std;
 
 #define SCREEN_WIDTH 64
@@ -14,47 +29,107 @@ int scale = 10;
 int display_width = SCREEN_WIDTH * scale;
 int display_height = SCREEN_HEIGHT * scale;
 
-// chip8
+// chip8, run on its own thread; everything the emulation thread touches
+// below is only reached through emulateFrame and runCommand
 chip8 localChip8;
+chip8clock localClock(localChip8);
+chip8thread emulator(localChip8, localClock);
+
+// the last 30 seconds of frames, stepped back through while backspace is held
+chip8rewind rewindBuffer(30 * chip8clock::framesPerSecond);
+bool rewinding = false;
+#define QUICKSAVE "chip8.c8s"
+
+// every session is recorded, and written out on exit
+unique_ptr<chip8recorder> recorder;
+#define MOVIE "chip8.c8m"
+
+// debugger on a local port, with --debug <port>
+unique_ptr<chip8debug> debugger;
+
+// frames exported to shared memory, with --publish <name>
+chip8publisher publisher;
+bool publishStep();
+
+// commands from the UI thread to the emulation thread
+enum command { REWIND_START, REWIND_STOP, QUICK_SAVE, QUICK_LOAD };
+bool emulateFrame();
+void runCommand(int code);
+void quit();
+
+// keyboard key for each keypad key 0-F
+const char keymap[] = "x123qweasdzc4rfv";
 
 void display();
 void reshape_window(GLsizei w, GLsizei h);
 void keypadboardUp(unsigned char keypad, int x, int y);
 void keypadboardDown(unsigned char keypad, int x, int y);
+void specialDown(int key, int x, int y);
 
 // Use new drawing method
 #define DRAWWITHTEXTURE
-typedef unsigned char BYTE;
-BYTE screenData[SCREEN_HEIGHT][SCREEN_WIDTH][3];
+chip8framebuffer screen;
 void setupTexture();
 
 
 int main(int argc, char **argv)
 {
-    // load game
-    if(localChip8.loadGame(PATH)){
-        cout << "Loaded " << PATH << " successfully." << endl;
+    // usage: chip8 [--debug port] [--publish name] <rom>
+    int i = 1;
+    for(; i + 1 < argc && strncmp(argv[i], "--", 2) == 0; i += 2)
+    {
+        if(strcmp(argv[i], "--debug") == 0)
+        {
+            debugger.reset(new chip8debug(localChip8));
+            if(!debugger->listen(atoi(argv[i + 1])))
+                return 1;
+        }
+        else if(strcmp(argv[i], "--publish") == 0)
+        {
+            if(!publisher.create(argv[i + 1]))
+                return 1;
+        }
+        else
+            break;
+    }
+    if(i + 1 != argc)
+    {
+        cerr << "usage: " << argv[0] << " [--debug port] [--publish name] <rom>" << endl;
+        return 1;
     }
 
-//    // Setup OpenGL
-//    glutInit(&argc, argv);
-//    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
-//
-//    glutInitWindowSize(display_width, display_height);
-//    glutInitWindowPosition(320, 320);
-//    glutCreateWindow("chip8");
-//
-//    glutDisplayFunc(display);
-//    glutIdleFunc(display);
-//    glutReshapeFunc(reshape_window);
-//    glutKeyboardFunc(keypadboardDown);
-//    glutKeyboardUpFunc(keypadboardUp);
-//
-//#ifdef DRAWWITHTEXTURE
-//    setupTexture();
-//#endif
-//
-//    glutMainLoop();
+    // load game
+    if(!localChip8.loadGame(argv[i]))
+        return 1;
+    cout << "Loaded " << argv[i] << " successfully." << endl;
+
+    recorder.reset(new chip8recorder(localChip8));
+    atexit(quit);
+    emulator.onStep(publisher.isOpen() ? publishStep : emulateFrame);
+    emulator.onCommand(runCommand);
+
+    // Setup OpenGL
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
+
+    glutInitWindowSize(display_width, display_height);
+    glutInitWindowPosition(320, 320);
+    glutCreateWindow("chip8");
+
+    glutDisplayFunc(display);
+    glutIdleFunc(display);
+    glutReshapeFunc(reshape_window);
+    glutKeyboardFunc(keypadboardDown);
+    glutKeyboardUpFunc(keypadboardUp);
+    glutSpecialFunc(specialDown);
+
+#ifdef DRAWWITHTEXTURE
+    setupTexture();
+#endif
+
+    // the emulation thread owns localChip8 from here on, until quit()
+    emulator.start();
+    glutMainLoop();
 
     return 0;
 }
@@ -62,13 +137,8 @@ int main(int argc, char **argv)
 // Setup Texture
 void setupTexture()
 {
-    // Clear screen
-    for(int y = 0; y < SCREEN_HEIGHT; ++y)
-        for(int x = 0; x < SCREEN_WIDTH; ++x)
-            screenData[y][x][0] = screenData[y][x][1] = screenData[y][x][2] = 0;
-
-    // Create a texture 
-    glTexImage2D(GL_TEXTURE_2D, 0, 3, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screenData);
+    // Create a texture from the (blank) framebuffer
+    glTexImage2D(GL_TEXTURE_2D, 0, 3, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screen.pixels());
 
     // Set up the texture
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -80,18 +150,15 @@ void setupTexture()
     glEnable(GL_TEXTURE_2D);
 }
 
-void updateTexture(const chip8& c8)
+void updateTexture(const uint64_t* frame, uint32_t rows)
 {
-    // Update pixels
-    for(int y = 0; y < 32; ++y)
-        for(int x = 0; x < 64; ++x)
-            if(c8.gfx[(y * 64) + x] == 0)
-                screenData[y][x][0] = screenData[y][x][1] = screenData[y][x][2] = 0;	// Disabled
-            else
-                screenData[y][x][0] = screenData[y][x][1] = screenData[y][x][2] = 255;  // Enabled
+    // Update pixels of the damaged rows only
+    screen.render(frame, rows);
 
-    // Update Texture
-    glTexSubImage2D(GL_TEXTURE_2D, 0 ,0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screenData);
+    // Update Texture, uploading the span of rows that changed
+    int first, last;
+    if(chip8::rowSpan(rows, first, last))
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, SCREEN_WIDTH, last - first + 1, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screen.row(first));
 
     glBegin( GL_QUADS );
     glTexCoord2d(0.0, 0.0);		glVertex2d(0.0,			  0.0);
@@ -112,13 +179,13 @@ void drawPixel(int x, int y)
     glEnd();
 }
 
-void updateQuads(const chip8& c8)
+void updateQuads(const uint64_t* frame)
 {
     // Draw
     for(int y = 0; y < 32; ++y)
         for(int x = 0; x < 64; ++x)
         {
-            if(c8.gfx[(y*64) + x] == 0)
+            if(((frame[y] >> (63 - x)) & 1) == 0)
                 glColor3f(0.0f,0.0f,0.0f);
             else
                 glColor3f(1.0f,1.0f,1.0f);
@@ -127,26 +194,100 @@ void updateQuads(const chip8& c8)
         }
 }
 
-void display()
+// emulation thread: run whatever frames are due, at most one 60 Hz frame
+// per call when on time; true when the display may have changed
+bool emulateFrame()
+{
+    if(debugger)
+    {
+        // nothing runs while paused but single steps; the frames that
+        // come due are dropped
+        unsigned long long cycles = localChip8.getCycleCount();
+        debugger->poll();
+        if(debugger->paused())
+        {
+            localClock.skipDue();
+            return localChip8.getCycleCount() != cycles;
+        }
+    }
+
+    if(rewinding)
+    {
+        // step back one saved frame for every frame that comes due
+        bool stepped = false;
+        chip8state state;
+        for(unsigned long due = localClock.skipDue(); due > 0 && rewindBuffer.rewind(1, state); --due)
+        {
+            localChip8.loadState(state);
+            stepped = true;
+        }
+        recorder->truncate();
+        return stepped;
+    }
+
+    recorder->update();
+    if(localClock.runDue() == 0)
+        return false;
+
+    chip8state state;
+    localChip8.saveState(state);
+    rewindBuffer.push(state);
+    return true;
+}
+
+// emulation thread: emulateFrame, exporting every frame that changed anything
+bool publishStep()
+{
+    bool changed = emulateFrame();
+    if(changed)
+        publisher.publish(localChip8);
+    return changed;
+}
+
+// emulation thread: commands posted from the key handlers
+void runCommand(int code)
+{
+    switch(code)
+    {
+    case REWIND_START:  rewinding = true; break;
+    case REWIND_STOP:   rewinding = false; break;
+    case QUICK_SAVE:    localChip8.saveState(string(QUICKSAVE)); break;
+    case QUICK_LOAD:
+        if(localChip8.loadState(string(QUICKSAVE)))
+        {
+            rewindBuffer.clear();
+            recorder->truncate();
+        }
+        break;
+    }
+}
+
+// at exit, whether from Esc or from closing the window: stop the
+// emulation thread, which owns the instance until then, and save the movie
+void quit()
 {
-    localChip8.emulateCycle();
+    emulator.stop();
+    recorder->finish().save(MOVIE);
+}
 
-    if(localChip8.drawFlag)
+void display()
+{
+    // show the newest frame the emulation thread has published, if any
+    uint32_t rows;
+    const chip8frame* frame = emulator.latest(rows);
+    if(frame && rows)
     {
         // Clear framebuffer
         glClear(GL_COLOR_BUFFER_BIT);
 
 #ifdef DRAWWITHTEXTURE
-        updateTexture(localChip8);
+        updateTexture(frame->display, rows);
 #else
-        updateQuads(localChip8);
+        updateQuads(frame->display);
 #endif
 
         // Swap buffers!
         glutSwapBuffers();
-
-        // Processed frame
-        localChip8.drawFlag = false;
     }
 }
 
@@ -169,48 +310,29 @@ void keypadboardDown(unsigned char keypad, int x, int y)
     if(keypad == 27)    // esc
         exit(0);
 
-    if(keypad == '1')		localChip8.keypad[0x1] = 1;
-    else if(keypad == '2')	localChip8.keypad[0x2] = 1;
-    else if(keypad == '3')	localChip8.keypad[0x3] = 1;
-    else if(keypad == '4')	localChip8.keypad[0xC] = 1;
-
-    else if(keypad == 'q')	localChip8.keypad[0x4] = 1;
-    else if(keypad == 'w')	localChip8.keypad[0x5] = 1;
-    else if(keypad == 'e')	localChip8.keypad[0x6] = 1;
-    else if(keypad == 'r')	localChip8.keypad[0xD] = 1;
+    if(keypad == 8)     // backspace
+        emulator.command(REWIND_START);
 
-    else if(keypad == 'a')	localChip8.keypad[0x7] = 1;
-    else if(keypad == 's')	localChip8.keypad[0x8] = 1;
-    else if(keypad == 'd')	localChip8.keypad[0x9] = 1;
-    else if(keypad == 'f')	localChip8.keypad[0xE] = 1;
-
-    else if(keypad == 'z')	localChip8.keypad[0xA] = 1;
-    else if(keypad == 'x')	localChip8.keypad[0x0] = 1;
-    else if(keypad == 'c')	localChip8.keypad[0xB] = 1;
-    else if(keypad == 'v')	localChip8.keypad[0xF] = 1;
+    for(int k = 0; k < 16; ++k)
+        if(keypad == keymap[k])
+            emulator.pressKey(k, true);
 
     //printf("Press keypad %c\n", keypad);
 }
 
 void keypadboardUp(unsigned char keypad, int x, int y)
 {
-    if (keypad == '1') localChip8.keypad[0x1] = 0;
-    else if (keypad == '2') localChip8.keypad[0x2] = 0;
-    else if (keypad == '3') localChip8.keypad[0x3] = 0;
-    else if (keypad == '4') localChip8.keypad[0xC] = 0;
-
-    else if (keypad == 'q') localChip8.keypad[0x4] = 0;
-    else if (keypad == 'w') localChip8.keypad[0x5] = 0;
-    else if (keypad == 'e') localChip8.keypad[0x6] = 0;
-    else if (keypad == 'r') localChip8.keypad[0xD] = 0;
-
-    else if (keypad == 'a') localChip8.keypad[0x7] = 0;
-    else if (keypad == 's') localChip8.keypad[0x8] = 0;
-    else if (keypad == 'd') localChip8.keypad[0x9] = 0;
-    else if (keypad == 'f') localChip8.keypad[0xE] = 0;
-
-    else if (keypad == 'z') localChip8.keypad[0xA] = 0;
-    else if (keypad == 'x') localChip8.keypad[0x0] = 0;
-    else if (keypad == 'c') localChip8.keypad[0xB] = 0;
-    else if (keypad == 'v') localChip8.keypad[0xF] = 0;
-}
\ No newline at end of file
+    if (keypad == 8) emulator.command(REWIND_STOP);
+
+    for(int k = 0; k < 16; ++k)
+        if(keypad == keymap[k])
+            emulator.pressKey(k, false);
+}
+void specialDown(int key, int x, int y)
+{
+    // F5 quick save, F9 quick load
+    if(key == GLUT_KEY_F5)
+        emulator.command(QUICK_SAVE);
+    else if(key == GLUT_KEY_F9)
+        emulator.command(QUICK_LOAD);
+}
@@ -0,0 +1,70 @@
+//
+// Headless movie replay: plays an input movie against a ROM as fast as
+// the host allows and checks every recorded checkpoint.
+//
+// usage: replay [--jit] [--keep-going] <rom> <movie>
+//
+// Exits 0 when every checkpoint matches, 1 on a mismatch and 2 when the
+// ROM or movie can't be loaded or don't belong together.
+//
+
+#include <iostream>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "chip8.h"
+#include "chip8movie.h"
+#include "chip8clock.h"
+using namespace std;
+
+int main(int argc, char **argv)
+{
+    bool useJit = false;
+    bool stopAtMismatch = true;
+    const char* paths[2] = { nullptr, nullptr };
+    int count = 0;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--jit") == 0) useJit = true;
+        else if(strcmp(argv[i], "--keep-going") == 0) stopAtMismatch = false;
+        else if(count < 2) paths[count++] = argv[i];
+    }
+    if(count < 2) {
+        cerr << "usage: " << argv[0] << " [--jit] [--keep-going] <rom> <movie>" << endl;
+        return 2;
+    }
+
+    chip8movie movie;
+    if(!movie.load(paths[1])) {
+        cerr << "Could not read movie " << paths[1] << endl;
+        return 2;
+    }
+
+    unique_ptr<chip8> c8(new chip8());
+    if(!c8->loadGame(paths[0])) return 2;
+    c8->enableJit(useJit);
+
+    auto start = chrono::steady_clock::now();
+    replayResult r = replayMovie(*c8, movie, stopAtMismatch);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if(!r.romMatches) {
+        fprintf(stderr, "%s is not the ROM this movie was recorded on (hash %016llx, movie wants %016llx)\n",
+                paths[0], (unsigned long long)c8->getRomHash(), (unsigned long long)movie.romHash);
+        return 2;
+    }
+
+    double gameSeconds = double(r.cycles) / movie.cyclesPerFrame / chip8clock::framesPerSecond;
+    printf("%llu cycles, %zu of %zu checkpoints checked, %.3f s (%.0fx real time)\n",
+           (unsigned long long)r.cycles, r.checkpointsChecked, movie.checkpoints.size(),
+           seconds, seconds > 0 ? gameSeconds / seconds : 0);
+
+    if(r.firstMismatch >= 0) {
+        const movieCheckpoint& c = movie.checkpoints[r.firstMismatch];
+        printf("mismatch at checkpoint %ld (cycle %llu)\n", r.firstMismatch, (unsigned long long)c.cycle);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
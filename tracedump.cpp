@@ -0,0 +1,52 @@
+//
+// Offline decoder for chip8 trace dumps.
+//
+// usage: tracedump <trace file>
+//
+// Prints one line per record, oldest first: program counter, opcode,
+// index register and every V register the instruction changed.
+//
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include "chip8trace.h"
+using namespace std;
+
+int main(int argc, char **argv)
+{
+    if(argc < 2) {
+        cerr << "usage: " << argv[0] << " <trace file>" << endl;
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if(!in) {
+        cerr << "Could not open " << argv[1] << endl;
+        return 1;
+    }
+
+    traceHeader header;
+    if(fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, "C8TR", 4) != 0) {
+        cerr << argv[1] << " is not a chip8 trace" << endl;
+        return 1;
+    }
+    if(header.version != traceVersion || header.recordSize != sizeof(traceRecord)) {
+        cerr << argv[1] << ": unsupported trace version " << header.version << endl;
+        return 1;
+    }
+
+    traceRecord r;
+    uint32_t read = 0;
+    while(read < header.count && fread(&r, sizeof(r), 1, in) == 1) {
+        chip8trace::print(stdout, r);
+        ++read;
+    }
+    fclose(in);
+
+    if(read != header.count) {
+        cerr << argv[1] << ": truncated, " << read << " of " << header.count << " records" << endl;
+        return 1;
+    }
+    return 0;
+}